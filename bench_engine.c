@@ -0,0 +1,477 @@
+// Headless engine harness: drives DkstEngine without ibus-daemon by
+// building engine.c against headless/ibus.h, replays recorded key events
+// and reports throughput and per-event latency.
+//
+// Usage: bench_engine [-a] [-s] [-n rounds] [-c config.ini] [-u entries]
+//                     [-f ms] [-l latency.txt] [-t trace.txt] file.keys...
+//
+// Key files hold one command per line ('#' starts a comment):
+//   type <text>      Press and release each character (Shift as needed)
+//   key <keyspec>    Press and release one key, e.g. "Hangul_Hanja",
+//                    "Shift+space", "BackSpace"
+//   expect <text>    The text the application received since the last
+//                    expect must be <text>, with C escapes such as "\n"
+//                    (checked in the first round only). Keys the engine
+//                    does not handle are applied as the application would.
+//   expect-aux [<text>]
+//                    The auxiliary text shown must be <text>, or none
+//                    (checked in the first round only)
+// Every round replays the whole file; the first one also warms up the
+// dictionaries and is not timed. -l writes the engine's own latency
+// histograms (latency.h) for the timed rounds, as SIGUSR1 does in dkst-ime;
+// -t writes the trace ring (trace.h) at exit, as SIGUSR2 does.
+// Heap calls the engine makes while handling keys in the timed rounds are
+// counted; -a fails the file if there are any. -s replays against a client
+// without surrounding text support.
+//
+// Before the files, startup is timed: from creating the first engine to
+// its first key press returning, and to the dictionary having loaded behind
+// it. -u adds a user dictionary of that many generated entries to show the
+// first key does not depend on the dictionary size; -f fails the run if
+// the first key takes longer than ms.
+
+#include "latency.h"
+#include "stats.h"
+#include "trace.h"
+#include <glib/gstdio.h>
+#include <ibus.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+GType dkst_engine_get_type(void);
+
+// Every allocator entry point is wrapped with a counter, as in
+// test_hangul_alloc.c. Only the thread that turns counting on is counted,
+// so dictionary loads on worker threads are left out.
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t n, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void __libc_free(void *ptr);
+
+static __thread int counting = 0;
+static __thread long n_heap_calls = 0;
+
+void *malloc(size_t size) {
+  n_heap_calls += counting;
+  return __libc_malloc(size);
+}
+
+void *calloc(size_t n, size_t size) {
+  n_heap_calls += counting;
+  return __libc_calloc(n, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+  n_heap_calls += counting;
+  return __libc_realloc(ptr, size);
+}
+
+void free(void *ptr) {
+  n_heap_calls += counting && ptr;
+  __libc_free(ptr);
+}
+
+typedef enum { EVENT_KEY, EVENT_EXPECT, EVENT_EXPECT_AUX } EventType;
+
+typedef struct {
+  EventType type;
+  guint keyval;
+  guint state;
+  gchar *expect; // EVENT_EXPECT, EVENT_EXPECT_AUX
+  guint line;
+} Event;
+
+static gboolean parse_keyspec(const char *spec, guint *keyval, guint *state) {
+  gchar **parts = g_strsplit(spec, "+", -1);
+  guint n = g_strv_length(parts);
+  gboolean ok = n > 0;
+
+  *state = 0;
+  for (guint i = 0; ok && i + 1 < n; i++) {
+    if (g_ascii_strcasecmp(parts[i], "Shift") == 0)
+      *state |= IBUS_SHIFT_MASK;
+    else if (g_ascii_strcasecmp(parts[i], "Control") == 0 ||
+             g_ascii_strcasecmp(parts[i], "Ctrl") == 0)
+      *state |= IBUS_CONTROL_MASK;
+    else if (g_ascii_strcasecmp(parts[i], "Alt") == 0)
+      *state |= IBUS_MOD1_MASK;
+    else if (g_ascii_strcasecmp(parts[i], "Super") == 0)
+      *state |= IBUS_SUPER_MASK;
+    else
+      ok = FALSE;
+  }
+  if (ok) {
+    *keyval = ibus_keyval_from_name(parts[n - 1]);
+    ok = *keyval != 0xffffff;
+  }
+  g_strfreev(parts);
+  return ok;
+}
+
+static void add_key(GArray *events, guint keyval, guint state, guint line) {
+  Event press = {EVENT_KEY, keyval, state, NULL, line};
+  Event release = {EVENT_KEY, keyval, state | IBUS_RELEASE_MASK, NULL, line};
+  g_array_append_val(events, press);
+  g_array_append_val(events, release);
+}
+
+static GArray *load_events(const char *path) {
+  gchar *contents;
+  GError *error = NULL;
+  if (!g_file_get_contents(path, &contents, NULL, &error)) {
+    fprintf(stderr, "%s\n", error->message);
+    g_error_free(error);
+    return NULL;
+  }
+
+  GArray *events = g_array_new(FALSE, FALSE, sizeof(Event));
+  gchar **lines = g_strsplit(contents, "\n", -1);
+  gboolean ok = TRUE;
+  for (guint i = 0; ok && lines[i]; i++) {
+    const char *line = lines[i];
+    if (line[0] == '#' || line[0] == '\0')
+      continue;
+
+    if (g_str_has_prefix(line, "type ")) {
+      for (const char *c = line + 5; *c; c++) {
+        // Uppercase letters and shifted symbols are typed with Shift
+        guint state = g_ascii_isupper(*c) || strchr("~!@#$%^&*()_+{}|:\"<>?", *c)
+                          ? IBUS_SHIFT_MASK
+                          : 0;
+        add_key(events, (guchar)*c, state, i + 1);
+      }
+    } else if (g_str_has_prefix(line, "key ")) {
+      guint keyval, state;
+      ok = parse_keyspec(g_strstrip(lines[i] + 4), &keyval, &state);
+      if (ok)
+        add_key(events, keyval, state, i + 1);
+    } else if (g_str_has_prefix(line, "expect ")) {
+      Event expect = {EVENT_EXPECT, 0, 0, g_strcompress(line + 7), i + 1};
+      g_array_append_val(events, expect);
+    } else if (strcmp(line, "expect-aux") == 0 ||
+               g_str_has_prefix(line, "expect-aux ")) {
+      Event expect = {EVENT_EXPECT_AUX, 0, 0,
+                      g_strcompress(line[10] ? line + 11 : ""), i + 1};
+      g_array_append_val(events, expect);
+    } else {
+      ok = FALSE;
+    }
+    if (!ok)
+      fprintf(stderr, "%s:%u: cannot parse '%s'\n", path, i + 1, line);
+  }
+  g_strfreev(lines);
+  g_free(contents);
+  if (!ok) {
+    g_array_free(events, TRUE);
+    return NULL;
+  }
+  return events;
+}
+
+static gint64 now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (gint64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int compare_latency(const void *a, const void *b) {
+  gint64 x = *(const gint64 *)a, y = *(const gint64 *)b;
+  return (x > y) - (x < y);
+}
+
+static gint64 percentile(const GArray *sorted, double p) {
+  guint i = (guint)(p / 100.0 * (sorted->len - 1) + 0.5);
+  return g_array_index(sorted, gint64, i);
+}
+
+// The application handles keys the engine passes on: printable characters
+// are typed, Return starts a new line, BackSpace deletes before the cursor
+static void pass_to_client(guint keyval, guint state) {
+  GString *text = headless_sink.committed;
+
+  if (state & (IBUS_RELEASE_MASK | IBUS_CONTROL_MASK | IBUS_MOD1_MASK |
+               IBUS_SUPER_MASK))
+    return;
+  if (keyval >= 0x20 && keyval <= 0x7e) {
+    g_string_append_c(text, (gchar)keyval);
+  } else if (keyval == IBUS_KEY_Return) {
+    g_string_append_c(text, '\n');
+  } else if (keyval == IBUS_KEY_BackSpace && text->len > 0) {
+    const gchar *last = g_utf8_prev_char(text->str + text->len);
+    g_string_truncate(text, last - text->str);
+  }
+}
+
+// Set up an engine the way IBus does for a client
+static IBusEngine *new_engine(gboolean no_surrounding) {
+  IBusEngine *engine = g_object_new(dkst_engine_get_type(), NULL);
+  IBusEngineClass *klass = IBUS_ENGINE_GET_CLASS(engine);
+  // Like IBus, store what the client supports before telling the engine
+  engine->client_capabilities =
+      IBUS_CAP_PREEDIT_TEXT | IBUS_CAP_AUXILIARY_TEXT | IBUS_CAP_LOOKUP_TABLE |
+      IBUS_CAP_FOCUS | IBUS_CAP_PROPERTY;
+  if (!no_surrounding)
+    engine->client_capabilities |= IBUS_CAP_SURROUNDING_TEXT;
+  klass->set_capabilities(engine, engine->client_capabilities);
+  klass->focus_in(engine);
+  return engine;
+}
+
+// The first engine starts the dictionary load; its first key must not wait
+// for it. Returns FALSE if that key took longer than max_ms (if nonzero).
+static gboolean bench_startup(double max_ms) {
+  headless_sink_reset();
+  gint64 start = now_ns();
+  IBusEngine *engine = new_engine(FALSE);
+  IBusEngineClass *klass = IBUS_ENGINE_GET_CLASS(engine);
+  klass->process_key_event(engine, 'r', 0, 0);
+  gint64 first_key = now_ns() - start;
+
+  // Give up waiting after a minute, in case no dictionary can be read
+  while (dkst_stats.dict.n_keys == 0 &&
+         now_ns() - start < 60 * G_GINT64_CONSTANT(1000000000)) {
+    if (!g_main_context_iteration(NULL, FALSE))
+      g_usleep(100);
+  }
+  gint64 loaded = now_ns() - start;
+
+  klass->focus_out(engine);
+  g_object_unref(engine);
+
+  printf("startup: first key handled after %.3f ms, dictionary of %u keys "
+         "loaded after %.3f ms\n",
+         first_key / 1e6, dkst_stats.dict.n_keys, loaded / 1e6);
+  if (max_ms > 0 && first_key / 1e6 > max_ms) {
+    fprintf(stderr, "startup: first key took longer than %g ms\n", max_ms);
+    return FALSE;
+  }
+  return TRUE;
+}
+
+// Write a user dictionary of n entries that no key file types: three
+// syllables starting with 뷁, each with one candidate
+static gboolean write_user_dict(const char *path, guint n) {
+  GString *text = g_string_new("");
+  for (guint i = 0; i < n; i++) {
+    g_string_append(text, "뷁");
+    g_string_append_unichar(text, 0xAC00 + i / 11172 % 11172);
+    g_string_append_unichar(text, 0xAC00 + i % 11172);
+    g_string_append(text, ":韓\n");
+  }
+  gboolean ok = g_file_set_contents(path, text->str, text->len, NULL);
+  g_string_free(text, TRUE);
+  return ok;
+}
+
+// Replay events once. Latencies are appended (and heap calls counted) if
+// given; expectations are checked if asked. Returns FALSE if an expectation
+// failed.
+static gboolean replay(IBusEngine *engine, const char *path, GArray *events,
+                       GArray *latencies, gboolean check) {
+  IBusEngineClass *klass = IBUS_ENGINE_GET_CLASS(engine);
+  gboolean ok = TRUE;
+
+  for (guint i = 0; i < events->len; i++) {
+    const Event *ev = &g_array_index(events, Event, i);
+
+    if (ev->type == EVENT_EXPECT) {
+      if (check && strcmp(headless_sink.committed->str, ev->expect) != 0) {
+        fprintf(stderr, "%s:%u: expected '%s', committed '%s'\n", path,
+                ev->line, ev->expect, headless_sink.committed->str);
+        ok = FALSE;
+      }
+      g_string_truncate(headless_sink.committed, 0);
+      continue;
+    }
+    if (ev->type == EVENT_EXPECT_AUX) {
+      if (check && strcmp(headless_sink.auxiliary->str, ev->expect) != 0) {
+        fprintf(stderr, "%s:%u: expected auxiliary text '%s', shown '%s'\n",
+                path, ev->line, ev->expect, headless_sink.auxiliary->str);
+        ok = FALSE;
+      }
+      continue;
+    }
+
+    counting = (latencies != NULL);
+    gint64 start = now_ns();
+    gboolean handled =
+        klass->process_key_event(engine, ev->keyval, 0, ev->state);
+    gint64 elapsed = now_ns() - start;
+    counting = 0;
+    if (latencies)
+      g_array_append_val(latencies, elapsed);
+    if (!handled)
+      pass_to_client(ev->keyval, ev->state);
+
+    // What the main loop would run between key events (dictionary loads,
+    // indicator timeouts)
+    while (g_main_context_iteration(NULL, FALSE))
+      ;
+  }
+  return ok;
+}
+
+static gboolean bench_file(const char *path, guint rounds,
+                           gboolean no_alloc, gboolean no_surrounding) {
+  GArray *events = load_events(path);
+  if (!events)
+    return FALSE;
+
+  IBusEngine *engine = new_engine(no_surrounding);
+  IBusEngineClass *klass = IBUS_ENGINE_GET_CLASS(engine);
+
+  headless_sink_reset();
+  gboolean ok = replay(engine, path, events, NULL, TRUE);
+
+  headless_sink_reset();
+  dkst_latency_reset();
+  n_heap_calls = 0;
+  GArray *latencies = g_array_new(FALSE, FALSE, sizeof(gint64));
+  gint64 start = now_ns();
+  for (guint r = 0; r < rounds; r++)
+    replay(engine, path, events, latencies, FALSE);
+  gint64 total = now_ns() - start;
+
+  guint n = latencies->len;
+  gint64 busy = 0;
+  for (guint i = 0; i < n; i++)
+    busy += g_array_index(latencies, gint64, i);
+  g_array_sort(latencies, compare_latency);
+
+  if (no_alloc && n_heap_calls > 0) {
+    fprintf(stderr, "%s: %ld heap calls while handling keys\n", path,
+            n_heap_calls);
+    ok = FALSE;
+  }
+  printf("%s: %u events x %u rounds%s\n", path, n / MAX(rounds, 1), rounds,
+         ok ? "" : " (EXPECTATIONS FAILED)");
+  if (n > 0) {
+    printf("  %.0f events/s in the engine (%.0f/s with main loop "
+           "dispatch)\n",
+           n / (busy / 1e9), n / (total / 1e9));
+    printf("  latency ns: p50 %" G_GINT64_FORMAT "  p90 %" G_GINT64_FORMAT
+           "  p99 %" G_GINT64_FORMAT "  p99.9 %" G_GINT64_FORMAT
+           "  max %" G_GINT64_FORMAT "\n",
+           percentile(latencies, 50), percentile(latencies, 90),
+           percentile(latencies, 99), percentile(latencies, 99.9),
+           g_array_index(latencies, gint64, n - 1));
+    printf("  client calls per event: commit %.3f  preedit %.3f  "
+           "lookup table %.3f  auxiliary %.3f  property %.3f\n",
+           (double)headless_sink.n_commits / n,
+           (double)headless_sink.n_preedit / n,
+           (double)headless_sink.n_lookup_table / n,
+           (double)headless_sink.n_auxiliary / n,
+           (double)headless_sink.n_property / n);
+    printf("  candidates sent per lookup table update: %.3f\n",
+           headless_sink.n_lookup_table
+               ? (double)headless_sink.n_candidates_sent /
+                     headless_sink.n_lookup_table
+               : 0.0);
+    printf("  heap calls per event: %.3f\n", (double)n_heap_calls / n);
+  }
+
+  klass->focus_out(engine);
+  g_object_unref(engine);
+  g_array_free(latencies, TRUE);
+  for (guint i = 0; i < events->len; i++)
+    g_free(g_array_index(events, Event, i).expect);
+  g_array_free(events, TRUE);
+  return ok;
+}
+
+int main(int argc, char **argv) {
+  guint rounds = 2000;
+  const char *config = NULL;
+  const char *latency_path = NULL;
+  const char *trace_path = NULL;
+  gboolean no_alloc = FALSE;
+  gboolean no_surrounding = FALSE;
+  guint user_entries = 0;
+  double max_startup_ms = 0;
+  int i = 1;
+
+  for (; i < argc && argv[i][0] == '-'; i++) {
+    if (strcmp(argv[i], "-a") == 0)
+      no_alloc = TRUE;
+    else if (strcmp(argv[i], "-s") == 0)
+      no_surrounding = TRUE;
+    else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+      rounds = atoi(argv[++i]);
+    else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc)
+      config = argv[++i];
+    else if (strcmp(argv[i], "-u") == 0 && i + 1 < argc)
+      user_entries = atoi(argv[++i]);
+    else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc)
+      max_startup_ms = atof(argv[++i]);
+    else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc)
+      latency_path = argv[++i];
+    else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+      trace_path = argv[++i];
+    else
+      break;
+  }
+  if (i >= argc) {
+    fprintf(stderr,
+            "Usage: %s [-a] [-s] [-n rounds] [-c config.ini] [-u entries] "
+            "[-f ms] [-l latency.txt] [-t trace.txt] file.keys...\n",
+            argv[0]);
+    return 1;
+  }
+
+  // A call libibus would refuse stops the run (see headless/ibus_mock.c)
+  g_log_set_always_fatal(G_LOG_LEVEL_CRITICAL);
+
+  // Keep the user's settings and dictionary out of the measurement
+  gchar *config_home = g_dir_make_tmp("dkst-bench-XXXXXX", NULL);
+  gchar *config_dir = g_build_filename(config_home, "ibus-dkst", NULL);
+  g_mkdir_with_parents(config_dir, 0700);
+  if (config) {
+    gchar *contents;
+    gsize len;
+    gchar *dest = g_build_filename(config_dir, "config.ini", NULL);
+    if (!g_file_get_contents(config, &contents, &len, NULL) ||
+        !g_file_set_contents(dest, contents, len, NULL)) {
+      fprintf(stderr, "%s: cannot use config %s\n", argv[0], config);
+      return 1;
+    }
+    g_free(contents);
+    g_free(dest);
+  }
+  gchar *user_dict = g_build_filename(config_dir, "hanja_user.txt", NULL);
+  if (user_entries && !write_user_dict(user_dict, user_entries)) {
+    fprintf(stderr, "%s: cannot write %s\n", argv[0], user_dict);
+    return 1;
+  }
+  g_setenv("XDG_CONFIG_HOME", config_home, TRUE);
+
+  int status = bench_startup(max_startup_ms) ? 0 : 1;
+  for (; i < argc; i++) {
+    if (!bench_file(argv[i], rounds, no_alloc, no_surrounding))
+      status = 1;
+  }
+
+  GError *error = NULL;
+  if (latency_path && !dkst_latency_dump(latency_path, &error)) {
+    fprintf(stderr, "%s\n", error->message);
+    g_clear_error(&error);
+    status = 1;
+  }
+  if (trace_path && !dkst_trace_dump(trace_path, &error)) {
+    fprintf(stderr, "%s\n", error->message);
+    g_clear_error(&error);
+    status = 1;
+  }
+
+  gchar *config_ini = g_build_filename(config_dir, "config.ini", NULL);
+  g_remove(config_ini);
+  g_remove(user_dict);
+  g_rmdir(config_dir);
+  g_rmdir(config_home);
+  g_free(config_ini);
+  g_free(user_dict);
+  g_free(config_dir);
+  g_free(config_home);
+  return status;
+}
@@ -33,6 +33,7 @@ cp dkst-ime "$DIR_NAME/usr/share/ibus-dkst/dkst-ime"
 cp setup.py "$DIR_NAME/usr/share/ibus-dkst/"
 cp hanja_editor.py "$DIR_NAME/usr/share/ibus-dkst/"
 cp hanja.txt "$DIR_NAME/usr/share/ibus-dkst/"
+cp hanja.dict "$DIR_NAME/usr/share/ibus-dkst/"
 cp icon.png "$DIR_NAME/usr/share/ibus-dkst/"
 
 # Copy dummy config for reference
@@ -46,6 +47,7 @@ chmod 755 "$DIR_NAME/usr/share/ibus-dkst/dkst-ime"
 chmod 755 "$DIR_NAME/usr/share/ibus-dkst/setup.py"
 chmod 755 "$DIR_NAME/usr/share/ibus-dkst/hanja_editor.py"
 chmod 644 "$DIR_NAME/usr/share/ibus-dkst/hanja.txt"
+chmod 644 "$DIR_NAME/usr/share/ibus-dkst/hanja.dict"
 chmod 644 "$DIR_NAME/usr/share/ibus-dkst/icon.png"
 
 chmod 644 "$DIR_NAME/usr/share/ibus-dkst/config.ini"
@@ -0,0 +1,221 @@
+#include "config.h"
+#include "trace.h"
+#include <ibus.h>
+#include <string.h>
+
+// Parse a key string like "Shift+space" or "Alt+Return". Returns FALSE if
+// the key name is unknown.
+static gboolean parse_key(const gchar *keystr, DkstConfigKey *key) {
+  key->keyval = 0;
+  key->modifiers = 0;
+
+  // Split by '+'
+  gchar **parts = g_strsplit(keystr, "+", -1);
+  guint len = g_strv_length(parts);
+
+  if (len > 0) {
+    // Last part is key name
+    key->keyval = ibus_keyval_from_name(parts[len - 1]);
+
+    // Previous parts are modifiers
+    for (guint i = 0; i < len - 1; i++) {
+      if (g_ascii_strcasecmp(parts[i], "Shift") == 0)
+        key->modifiers |= IBUS_SHIFT_MASK;
+      else if (g_ascii_strcasecmp(parts[i], "Control") == 0)
+        key->modifiers |= IBUS_CONTROL_MASK;
+      else if (g_ascii_strcasecmp(parts[i], "Alt") == 0)
+        key->modifiers |= IBUS_MOD1_MASK; // Alt is usually Mod1
+      else if (g_ascii_strcasecmp(parts[i], "Super") == 0)
+        key->modifiers |= IBUS_SUPER_MASK;
+      else if (g_ascii_strcasecmp(parts[i], "Meta") == 0)
+        key->modifiers |= IBUS_META_MASK;
+    }
+  }
+  g_strfreev(parts);
+
+  return key->keyval != 0;
+}
+
+static guint16 add_action(DkstConfig *config, DkstKeyActionType type,
+                          gchar *text) {
+  DkstKeyAction action = {type, text};
+  g_array_append_val(config->actions, action);
+  return config->actions->len;
+}
+
+// Point the dispatch entry of keyval with modifier index mods at action
+// (index + 1). Keys bound earlier keep their action, which gives Hanja keys
+// precedence over toggle keys and both over custom Shift mappings.
+static void bind_key(DkstConfig *config, guint keyval, guint mods,
+                     guint16 action) {
+  guint16 *entry;
+  if (keyval < 128) {
+    entry = &config->ascii_actions[keyval << DKST_MODIFIER_BITS | mods];
+  } else {
+    guint16 *row = g_hash_table_lookup(config->other_actions,
+                                       GUINT_TO_POINTER(keyval));
+    if (!row) {
+      row = g_new0(guint16, 1 << DKST_MODIFIER_BITS);
+      g_hash_table_insert(config->other_actions, GUINT_TO_POINTER(keyval),
+                          row);
+    }
+    entry = &row[mods];
+  }
+  if (*entry == 0)
+    *entry = action;
+}
+
+// Bind the ';'-separated keys in keys_str to action. Returns how many were
+// bound. kind is 0 for toggle keys and 1 for Hanja keys (for the trace).
+static guint bind_keys(DkstConfig *config, const gchar *keys_str, guint kind,
+                       guint16 action) {
+  guint n = 0;
+  gchar **names = g_strsplit(keys_str, ";", -1);
+  for (int i = 0; names[i] != NULL; i++) {
+    DkstConfigKey key;
+    if (strlen(names[i]) > 0 && parse_key(names[i], &key)) {
+      bind_key(config, key.keyval, DKST_MODIFIER_INDEX(key.modifiers), action);
+      dkst_trace(DKST_TRACE_CONFIG_KEY, kind, key.keyval, key.modifiers);
+      n++;
+    }
+  }
+  g_strfreev(names);
+  return n;
+}
+
+// Bind the keys of group (or the defaults if it has none) to a new action
+static void load_keys(DkstConfig *config, GKeyFile *key_file,
+                      const char *group, const char *defaults, guint kind,
+                      DkstKeyActionType type) {
+  guint16 action = add_action(config, type, NULL);
+  gchar *keys_str =
+      key_file ? g_key_file_get_string(key_file, group, "Keys", NULL) : NULL;
+  if (!keys_str || bind_keys(config, keys_str, kind, action) == 0)
+    bind_keys(config, defaults, kind, action);
+  g_free(keys_str);
+}
+
+// Custom Shift: [CustomShift] maps key names to text committed when the key
+// is pressed with Shift (whatever else is held) in Hangul mode
+static void load_shift_mappings(DkstConfig *config, GKeyFile *key_file) {
+  gsize length = 0;
+  gchar **keys = g_key_file_get_keys(key_file, "CustomShift", &length, NULL);
+  if (!keys)
+    return;
+
+  for (gsize i = 0; i < length; i++) {
+    guint keyval = ibus_keyval_from_name(keys[i]);
+    gchar *val = g_key_file_get_string(key_file, "CustomShift", keys[i], NULL);
+    if (keyval == 0 || keyval == IBUS_KEY_VoidSymbol || !val) {
+      g_free(val);
+      continue;
+    }
+    guint16 action = add_action(config, DKST_KEY_SHIFT_TEXT, val);
+    for (guint mods = 0; mods < 1 << DKST_MODIFIER_BITS; mods++) {
+      if (mods & DKST_MODIFIER_INDEX(IBUS_SHIFT_MASK))
+        bind_key(config, keyval, mods, action);
+    }
+  }
+  g_strfreev(keys);
+}
+
+DkstConfig *dkst_config_load(const char *path) {
+  DkstConfig *config = g_new0(DkstConfig, 1);
+  config->ref_count = 1;
+  config->enable_moa_jjiki = TRUE;
+  config->backspace_mode = DKST_BACKSPACE_JASO;
+  config->layout = g_strdup("dubeolsik");
+  config->enable_indicator = TRUE;
+  config->enable_custom_shift = FALSE;
+  config->word_preedit = FALSE;
+  config->actions = g_array_new(FALSE, FALSE, sizeof(DkstKeyAction));
+  config->other_actions =
+      g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+
+  GKeyFile *key_file = g_key_file_new();
+  if (!g_key_file_load_from_file(key_file, path, G_KEY_FILE_NONE, NULL)) {
+    g_key_file_free(key_file);
+    key_file = NULL;
+  }
+
+  if (key_file) {
+    // Moa-jjik-gi
+    if (g_key_file_has_key(key_file, "Settings", "EnableMoaJjiki", NULL)) {
+      config->enable_moa_jjiki =
+          g_key_file_get_boolean(key_file, "Settings", "EnableMoaJjiki", NULL);
+    }
+
+    // Backspace Mode
+    gchar *mode_str =
+        g_key_file_get_string(key_file, "Settings", "BackspaceMode", NULL);
+    if (g_strcmp0(mode_str, "CHAR") == 0)
+      config->backspace_mode = DKST_BACKSPACE_CHAR;
+    g_free(mode_str);
+
+    // Keyboard Layout (dubeolsik, sebeolsik-390, sebeolsik-final)
+    gchar *layout_str =
+        g_key_file_get_string(key_file, "Settings", "Layout", NULL);
+    if (layout_str) {
+      DKSTHangul scratch;
+      uint32_t commit[DKST_HANGUL_MAX_COMMIT];
+      dkst_hangul_init(&scratch, commit, G_N_ELEMENTS(commit));
+      if (dkst_hangul_set_layout(&scratch, layout_str)) {
+        g_free(config->layout);
+        config->layout = layout_str;
+      } else {
+        dkst_trace(DKST_TRACE_CONFIG_BAD_LAYOUT, 0, 0, 0);
+        g_free(layout_str);
+      }
+    }
+
+    // Indicator
+    if (g_key_file_has_key(key_file, "Settings", "EnableIndicator", NULL)) {
+      config->enable_indicator =
+          g_key_file_get_boolean(key_file, "Settings", "EnableIndicator", NULL);
+    }
+
+    // Custom Shift
+    if (g_key_file_has_key(key_file, "Settings", "EnableCustomShift", NULL)) {
+      config->enable_custom_shift = g_key_file_get_boolean(
+          key_file, "Settings", "EnableCustomShift", NULL);
+    }
+
+    // Word preedit
+    if (g_key_file_has_key(key_file, "Settings", "WordPreedit", NULL)) {
+      config->word_preedit =
+          g_key_file_get_boolean(key_file, "Settings", "WordPreedit", NULL);
+    }
+
+    dkst_trace(DKST_TRACE_CONFIG_LOADED, config->enable_moa_jjiki,
+               config->backspace_mode, config->enable_custom_shift);
+  }
+
+  // Compile the key dispatch table, highest precedence first
+  load_keys(config, key_file, "HanjaKeys", "Alt+Return;Hangul_Hanja", 1,
+            DKST_KEY_HANJA);
+  load_keys(config, key_file, "ToggleKeys", "Shift+space;Hangul", 0,
+            DKST_KEY_TOGGLE);
+  if (key_file && config->enable_custom_shift)
+    load_shift_mappings(config, key_file);
+
+  if (key_file)
+    g_key_file_free(key_file);
+  return config;
+}
+
+DkstConfig *dkst_config_ref(DkstConfig *config) {
+  g_atomic_int_inc(&config->ref_count);
+  return config;
+}
+
+void dkst_config_unref(DkstConfig *config) {
+  if (!config || !g_atomic_int_dec_and_test(&config->ref_count))
+    return;
+
+  g_free(config->layout);
+  for (guint i = 0; i < config->actions->len; i++)
+    g_free(g_array_index(config->actions, DkstKeyAction, i).text);
+  g_array_unref(config->actions);
+  g_hash_table_destroy(config->other_actions);
+  g_free(config);
+}
@@ -0,0 +1,77 @@
+#ifndef DKST_CONFIG_H
+#define DKST_CONFIG_H
+
+#include "hangul.h"
+#include <glib.h>
+
+// A key and the modifiers held with it ("Shift+space")
+typedef struct {
+  guint keyval;
+  guint modifiers; // IBus modifier mask
+} DkstConfigKey;
+
+// What a configured key does
+typedef enum {
+  DKST_KEY_HANJA,     // Convert to Hanja
+  DKST_KEY_TOGGLE,    // Switch between Hangul and English
+  DKST_KEY_SHIFT_TEXT // Commit text (custom Shift mapping, Hangul mode)
+} DkstKeyActionType;
+
+typedef struct {
+  DkstKeyActionType type;
+  gchar *text; // DKST_KEY_SHIFT_TEXT
+} DkstKeyAction;
+
+// The modifiers that tell configured keys apart (Shift, Control, Alt,
+// Super, Meta; not the locks), packed from IBus modifier bits 0, 2, 3, 26
+// and 28 into the low bits of a dispatch table index
+#define DKST_MODIFIER_BITS 5
+#define DKST_MODIFIER_INDEX(state)                                             \
+  (((state) & 0x1) | (((state) >> 1) & 0x6) | (((state) >> 23) & 0x8) |        \
+   (((state) >> 24) & 0x10))
+
+// Parsed ~/.config/ibus-dkst/config.ini. Immutable once loaded and
+// refcounted like HanjaDict: a changed file is parsed into a new snapshot
+// and engines move to it on their next focus-in, so the key path never
+// touches the file.
+typedef struct {
+  gint ref_count;
+  gboolean enable_moa_jjiki;
+  DKSTBackspaceMode backspace_mode;
+  gchar *layout; // A layout dkst_hangul_set_layout() knows
+  gboolean enable_indicator;
+  gboolean enable_custom_shift;
+  gboolean word_preedit; // Keep a word in the preedit until it ends
+
+  // Hanja, toggle and custom Shift keys compiled into one dispatch table.
+  // Entries are an index into actions plus one, or 0 for an ordinary key.
+  GArray *actions; // DkstKeyAction
+  guint16 ascii_actions[128 << DKST_MODIFIER_BITS]; // By keyval, modifiers
+  GHashTable *other_actions; // Other keyvals -> guint16[modifiers] row
+} DkstConfig;
+
+// Parse a config file. Settings it lacks (or a missing file) get defaults.
+DkstConfig *dkst_config_load(const char *path);
+
+// The action bound to a key press, or NULL. state is the IBus modifier
+// state of the press.
+static inline const DkstKeyAction *
+dkst_config_lookup_key(const DkstConfig *config, guint keyval, guint state) {
+  guint mods = DKST_MODIFIER_INDEX(state);
+  guint16 index;
+
+  if (keyval < 128) {
+    index = config->ascii_actions[keyval << DKST_MODIFIER_BITS | mods];
+  } else {
+    const guint16 *row =
+        g_hash_table_lookup(config->other_actions, GUINT_TO_POINTER(keyval));
+    index = row ? row[mods] : 0;
+  }
+  return index ? &g_array_index(config->actions, DkstKeyAction, index - 1)
+               : NULL;
+}
+
+DkstConfig *dkst_config_ref(DkstConfig *config);
+void dkst_config_unref(DkstConfig *config);
+
+#endif
@@ -0,0 +1,283 @@
+// dkst-convert: convert raw keystrokes (as typed on a US keyboard) into
+// Hangul text, streaming stdin to stdout.
+//
+// Usage: dkst-convert [-l layout] [-j threads] < keys.txt > hangul.txt
+//
+// A newline always finishes the syllable being composed, so every line
+// converts independently of the ones before it. Input is cut into
+// line-aligned chunks that worker threads convert in parallel; a writer
+// thread emits them in input order.
+
+#define _GNU_SOURCE // memrchr
+#include "hangul.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define CHUNK_SIZE (1 << 20) // Bytes read per chunk before line alignment
+
+typedef enum { SLOT_FREE, SLOT_FILLED, SLOT_CONVERTING, SLOT_DONE } SlotState;
+
+typedef struct {
+  SlotState state;
+  size_t seq; // Position of the chunk in the input
+  char *in;
+  size_t in_len, in_size;
+  char *out;
+  size_t out_len, out_size;
+} Slot;
+
+static Slot *slots;
+static size_t n_slots;
+static const char *layout_name = "dubeolsik";
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t changed = PTHREAD_COND_INITIALIZER;
+static size_t next_convert; // Next chunk a worker picks up
+static size_t n_chunks;     // Set once the reader hits end of input
+static bool input_done;
+static bool read_failed;  // Reader thread only
+static bool write_failed; // Writer thread only
+
+static void *xrealloc(void *p, size_t size) {
+  p = realloc(p, size);
+  if (!p) {
+    fprintf(stderr, "dkst-convert: out of memory\n");
+    exit(1);
+  }
+  return p;
+}
+
+static void convert_chunk(Slot *slot) {
+  DKSTHangul h;
+  uint32_t commit_buf[DKST_HANGUL_MAX_COMMIT];
+
+  dkst_hangul_init(&h, commit_buf, DKST_HANGUL_MAX_COMMIT);
+  dkst_hangul_set_layout(&h, layout_name);
+
+  // Hangul output is at most about three bytes per key; grow if it isn't
+  if (slot->out_size < slot->in_len * 3 + 64) {
+    slot->out_size = slot->in_len * 3 + 64;
+    slot->out = xrealloc(slot->out, slot->out_size);
+  }
+
+  // If out fills up, start over with more room rather than resume: a
+  // backspace in a later call could not delete what an earlier one wrote
+  for (;;) {
+    size_t used;
+    slot->out_len = dkst_hangul_process_string(
+        &h, slot->in, slot->in_len, slot->out, slot->out_size, &used);
+    if (used == slot->in_len)
+      break;
+    slot->out_size *= 2;
+    slot->out = xrealloc(slot->out, slot->out_size);
+    dkst_hangul_reset(&h);
+  }
+
+  // Only the final chunk can end inside a syllable (no trailing newline)
+  if (dkst_hangul_has_composed(&h)) {
+    char text[DKST_HANGUL_MAX_COMMIT * 4 + 1];
+    dkst_hangul_flush(&h);
+    size_t n = dkst_hangul_take_commit(&h, text, sizeof(text));
+    if (slot->out_size - slot->out_len < n) {
+      slot->out_size += n;
+      slot->out = xrealloc(slot->out, slot->out_size);
+    }
+    memcpy(slot->out + slot->out_len, text, n);
+    slot->out_len += n;
+  }
+}
+
+static void *worker(void *data) {
+  (void)data;
+  pthread_mutex_lock(&lock);
+  for (;;) {
+    Slot *slot = &slots[next_convert % n_slots];
+    if (slot->state == SLOT_FILLED && slot->seq == next_convert) {
+      next_convert++;
+      slot->state = SLOT_CONVERTING;
+      pthread_mutex_unlock(&lock);
+
+      convert_chunk(slot);
+
+      pthread_mutex_lock(&lock);
+      slot->state = SLOT_DONE;
+      pthread_cond_broadcast(&changed);
+    } else if (input_done && next_convert == n_chunks) {
+      break;
+    } else {
+      pthread_cond_wait(&changed, &lock);
+    }
+  }
+  pthread_mutex_unlock(&lock);
+  return NULL;
+}
+
+static void *writer(void *data) {
+  (void)data;
+  for (size_t seq = 0;; seq++) {
+    Slot *slot = &slots[seq % n_slots];
+
+    pthread_mutex_lock(&lock);
+    while (!(slot->state == SLOT_DONE && slot->seq == seq) &&
+           !(input_done && seq == n_chunks))
+      pthread_cond_wait(&changed, &lock);
+    if (input_done && seq == n_chunks) {
+      pthread_mutex_unlock(&lock);
+      break;
+    }
+    pthread_mutex_unlock(&lock);
+
+    if (fwrite(slot->out, 1, slot->out_len, stdout) != slot->out_len) {
+      perror("dkst-convert: write");
+      write_failed = true;
+    }
+
+    pthread_mutex_lock(&lock);
+    slot->state = SLOT_FREE;
+    pthread_cond_broadcast(&changed);
+    pthread_mutex_unlock(&lock);
+  }
+  if (fflush(stdout) != 0) {
+    perror("dkst-convert: write");
+    write_failed = true;
+  }
+  return NULL;
+}
+
+// Read the next chunk into slot, ending it after the last complete line.
+// Whatever follows that line is kept in carry for the next chunk. Returns
+// false at end of input with nothing left to convert.
+static bool read_chunk(Slot *slot, char **carry, size_t *carry_len,
+                       size_t *carry_size) {
+  size_t len = *carry_len;
+  bool eof = false;
+
+  if (slot->in_size < len + CHUNK_SIZE) {
+    slot->in_size = len + CHUNK_SIZE;
+    slot->in = xrealloc(slot->in, slot->in_size);
+  }
+  memcpy(slot->in, *carry, len);
+  *carry_len = 0;
+
+  // Fill the chunk, reading on until it holds a line break or the input ends
+  for (;;) {
+    size_t n = fread(slot->in + len, 1, slot->in_size - len, stdin);
+    len += n;
+    if (n == 0) {
+      if (ferror(stdin)) {
+        perror("dkst-convert: read");
+        read_failed = true;
+      }
+      eof = true;
+      break;
+    }
+    if (len == slot->in_size) {
+      if (memchr(slot->in, '\n', len))
+        break;
+      slot->in_size *= 2;
+      slot->in = xrealloc(slot->in, slot->in_size);
+    }
+  }
+
+  slot->in_len = len;
+  if (!eof) {
+    char *nl = memrchr(slot->in, '\n', len);
+    slot->in_len = nl - slot->in + 1;
+    *carry_len = len - slot->in_len;
+    if (*carry_size < *carry_len) {
+      *carry_size = *carry_len;
+      *carry = xrealloc(*carry, *carry_size);
+    }
+    memcpy(*carry, slot->in + slot->in_len, *carry_len);
+  }
+  return slot->in_len > 0 || !eof;
+}
+
+int main(int argc, char **argv) {
+  long n_threads = sysconf(_SC_NPROCESSORS_ONLN);
+  int opt;
+
+  while ((opt = getopt(argc, argv, "l:j:")) != -1) {
+    switch (opt) {
+    case 'l':
+      layout_name = optarg;
+      break;
+    case 'j':
+      n_threads = strtol(optarg, NULL, 10);
+      break;
+    default:
+      fprintf(stderr,
+              "Usage: %s [-l dubeolsik|sebeolsik-390|sebeolsik-final] "
+              "[-j threads] < keys.txt > hangul.txt\n",
+              argv[0]);
+      return 1;
+    }
+  }
+
+  DKSTHangul probe;
+  uint32_t probe_buf[DKST_HANGUL_MAX_COMMIT];
+  dkst_hangul_init(&probe, probe_buf, DKST_HANGUL_MAX_COMMIT);
+  if (!dkst_hangul_set_layout(&probe, layout_name)) {
+    fprintf(stderr, "%s: unknown layout '%s'\n", argv[0], layout_name);
+    return 1;
+  }
+  if (n_threads < 1)
+    n_threads = 1;
+
+  // Two chunks per worker keep everyone busy while the writer catches up
+  n_slots = n_threads * 2;
+  slots = calloc(n_slots, sizeof(Slot));
+  pthread_t *workers = calloc(n_threads, sizeof(pthread_t));
+  pthread_t writer_thread;
+  if (!slots || !workers) {
+    fprintf(stderr, "%s: out of memory\n", argv[0]);
+    return 1;
+  }
+
+  for (long i = 0; i < n_threads; i++)
+    pthread_create(&workers[i], NULL, worker, NULL);
+  pthread_create(&writer_thread, NULL, writer, NULL);
+
+  char *carry = NULL;
+  size_t carry_len = 0, carry_size = 0;
+  for (size_t seq = 0;; seq++) {
+    Slot *slot = &slots[seq % n_slots];
+
+    pthread_mutex_lock(&lock);
+    while (slot->state != SLOT_FREE)
+      pthread_cond_wait(&changed, &lock);
+    pthread_mutex_unlock(&lock);
+
+    bool more = read_chunk(slot, &carry, &carry_len, &carry_size);
+
+    pthread_mutex_lock(&lock);
+    if (more) {
+      slot->seq = seq;
+      slot->state = SLOT_FILLED;
+    }
+    if (!more || (feof(stdin) && carry_len == 0)) {
+      n_chunks = more ? seq + 1 : seq;
+      input_done = true;
+    }
+    pthread_cond_broadcast(&changed);
+    pthread_mutex_unlock(&lock);
+    if (input_done)
+      break;
+  }
+
+  for (long i = 0; i < n_threads; i++)
+    pthread_join(workers[i], NULL);
+  pthread_join(writer_thread, NULL);
+
+  for (size_t i = 0; i < n_slots; i++) {
+    free(slots[i].in);
+    free(slots[i].out);
+  }
+  free(slots);
+  free(workers);
+  free(carry);
+  return read_failed || write_failed ? 1 : 0;
+}
@@ -0,0 +1,22 @@
+// dkst-dictc: compile a "hangul:hanja1,hanja2,..." text dictionary into the
+// binary image that dkst-ime maps read-only at startup.
+//
+// Usage: dkst-dictc hanja.txt hanja.dict
+
+#include "hanja_dict.h"
+#include <stdio.h>
+
+int main(int argc, char **argv) {
+  if (argc != 3) {
+    fprintf(stderr, "Usage: %s <input.txt> <output.dict>\n", argv[0]);
+    return 1;
+  }
+
+  if (!hanja_dict_compile(argv[1], argv[2])) {
+    fprintf(stderr, "%s: failed to compile %s into %s\n", argv[0], argv[1],
+            argv[2]);
+    return 1;
+  }
+
+  return 0;
+}
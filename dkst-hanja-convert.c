@@ -0,0 +1,240 @@
+// dkst-hanja-convert: convert the Hangul words of a text file to Hanja with
+// the same system and user dictionaries dkst-ime uses.
+//
+// Usage: dkst-hanja-convert [-a] [-j threads] [-s system.dict] [-u user.txt]
+//                           input.txt > output.txt
+//
+// Each run of Hangul syllables is segmented by backward maximum matching:
+// from the end of the run, the longest dictionary word ending there is
+// taken (one walk of the reversed-key trie), then the search continues in
+// front of it. Syllables no word covers are kept as they are. Words become
+// their first candidate ("대한민국" -> "大韓民國"), or with -a are annotated
+// ("대한민국(大韓民國)"). The input is memory-mapped and split at line
+// breaks across worker threads; output keeps the input order.
+
+#include "hanja_dict.h"
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#define MAX_THREADS 1024 // Most worker threads -j accepts
+
+typedef struct {
+  const char *begin;
+  const char *end;
+  const char *hanja; // NULL if the syllables stay as they are
+} Segment;
+
+typedef struct {
+  const HanjaDict *dict;
+  const char *begin; // Line-aligned slice of the input
+  const char *end;
+  GString *out;
+} Job;
+
+static gboolean annotate = FALSE;
+
+static bool is_syllable(gunichar c) { return c >= 0xAC00 && c <= 0xD7A3; }
+
+// Decode the character at p, or return (gunichar)-1 for a byte that does
+// not start valid UTF-8 (copied through as-is)
+static gunichar next_char(const char *p, const char *end, const char **next) {
+  gunichar c = g_utf8_get_char_validated(p, end - p);
+  if (c == (gunichar)-1 || c == (gunichar)-2) {
+    *next = p + 1;
+    return (gunichar)-1;
+  }
+  *next = g_utf8_next_char(p);
+  return c;
+}
+
+// Segment one run of Hangul syllables back to front and append it
+static void convert_run(const HanjaDict *dict, const char *begin,
+                        const char *end, GArray *segments, GString *out) {
+  g_array_set_size(segments, 0);
+
+  const char *pos = end;
+  while (pos > begin) {
+    HanjaCandidates view;
+    Segment seg = {.end = pos};
+
+    if (hanja_dict_lookup_suffixes(dict, begin, pos - begin, &view, 1) > 0 &&
+        hanja_candidates_count(&view) > 1) {
+      seg.begin = view.hangul;
+      seg.hanja = hanja_candidates_get(&view, 0);
+    } else {
+      seg.begin = g_utf8_prev_char(pos);
+    }
+    g_array_append_val(segments, seg);
+    pos = seg.begin;
+  }
+
+  for (guint i = segments->len; i-- > 0;) {
+    const Segment *seg = &g_array_index(segments, Segment, i);
+    if (!seg->hanja) {
+      g_string_append_len(out, seg->begin, seg->end - seg->begin);
+    } else if (annotate) {
+      g_string_append_len(out, seg->begin, seg->end - seg->begin);
+      g_string_append_c(out, '(');
+      g_string_append(out, seg->hanja);
+      g_string_append_c(out, ')');
+    } else {
+      g_string_append(out, seg->hanja);
+    }
+  }
+}
+
+static gpointer convert_slice(gpointer data) {
+  Job *job = data;
+  GArray *segments = g_array_new(FALSE, FALSE, sizeof(Segment));
+  const char *p = job->begin;
+
+  while (p < job->end) {
+    const char *next;
+    gunichar c = next_char(p, job->end, &next);
+    if (!is_syllable(c)) {
+      g_string_append_len(job->out, p, next - p);
+      p = next;
+      continue;
+    }
+
+    const char *run = p;
+    while (p < job->end && is_syllable(next_char(p, job->end, &next)))
+      p = next;
+    convert_run(job->dict, run, p, segments, job->out);
+  }
+
+  g_array_free(segments, TRUE);
+  return NULL;
+}
+
+// A dictionary that cannot be read would load as an empty one and leave
+// the input unchanged, so report it instead
+static gboolean check_readable(const char *prog, const char *path) {
+  if (g_access(path, R_OK) == 0)
+    return TRUE;
+  fprintf(stderr, "%s: %s: %s\n", prog, path, g_strerror(errno));
+  return FALSE;
+}
+
+int main(int argc, char **argv) {
+  gint n_threads = g_get_num_processors();
+  gchar *system_path = NULL;
+  gchar *user_path = NULL;
+  GError *error = NULL;
+  gboolean bad_args = FALSE;
+  int opt;
+
+  while (!bad_args && (opt = getopt(argc, argv, "aj:s:u:")) != -1) {
+    switch (opt) {
+    case 'a':
+      annotate = TRUE;
+      break;
+    case 'j': {
+      char *end;
+      errno = 0;
+      long n = strtol(optarg, &end, 10);
+      if (end == optarg || *end || errno || n < 1 || n > MAX_THREADS) {
+        fprintf(stderr, "%s: -j takes 1 to %d threads, not '%s'\n", argv[0],
+                MAX_THREADS, optarg);
+        bad_args = TRUE;
+        break;
+      }
+      n_threads = n;
+      break;
+    }
+    case 's':
+      g_free(system_path);
+      system_path = g_strdup(optarg);
+      break;
+    case 'u':
+      g_free(user_path);
+      user_path = g_strdup(optarg);
+      break;
+    default:
+      bad_args = TRUE;
+    }
+  }
+  if (bad_args || optind != argc - 1) {
+    fprintf(stderr,
+            "Usage: %s [-a] [-j threads] [-s system.dict] [-u user.txt] "
+            "<input.txt>\n",
+            argv[0]);
+    return 1;
+  }
+
+  GMappedFile *input = g_mapped_file_new(argv[optind], FALSE, &error);
+  if (!input) {
+    fprintf(stderr, "%s: %s\n", argv[0], error->message);
+    g_error_free(error);
+    return 1;
+  }
+
+  // The user dictionary is optional unless it was named with -u
+  if (!system_path)
+    system_path = g_strdup(hanja_dict_system_path());
+  if (!check_readable(argv[0], system_path) ||
+      (user_path && !check_readable(argv[0], user_path))) {
+    g_mapped_file_unref(input);
+    g_free(system_path);
+    g_free(user_path);
+    return 1;
+  }
+  if (!user_path)
+    user_path = hanja_dict_user_path();
+  HanjaDict *dict = hanja_dict_new(system_path, user_path);
+
+  const char *data = g_mapped_file_get_contents(input);
+  gsize size = g_mapped_file_get_length(input);
+  if (n_threads < 1)
+    n_threads = 1;
+  // Small inputs aren't worth a thread each
+  n_threads = MIN((gsize)n_threads, size / 65536 + 1);
+
+  // Cut the input into roughly equal slices that end at line breaks
+  Job *jobs = g_new0(Job, n_threads);
+  const char *begin = data;
+  for (gint i = 0; i < n_threads; i++) {
+    const char *end = data + size * (i + 1) / n_threads;
+    if (end < begin)
+      end = begin;
+    if (i < n_threads - 1) {
+      const char *nl = memchr(end, '\n', data + size - end);
+      end = nl ? nl + 1 : data + size;
+    }
+    jobs[i].dict = dict;
+    jobs[i].begin = begin;
+    jobs[i].end = end;
+    jobs[i].out = g_string_sized_new(end - begin + 64);
+    begin = end;
+  }
+
+  GThread **threads = g_new(GThread *, n_threads);
+  for (gint i = 0; i < n_threads; i++)
+    threads[i] = g_thread_new("convert", convert_slice, &jobs[i]);
+
+  int status = 0;
+  for (gint i = 0; i < n_threads; i++) {
+    g_thread_join(threads[i]);
+    if (fwrite(jobs[i].out->str, 1, jobs[i].out->len, stdout) !=
+        jobs[i].out->len)
+      status = 1;
+    g_string_free(jobs[i].out, TRUE);
+  }
+  if (fflush(stdout) != 0)
+    status = 1;
+  if (status)
+    perror(argv[0]);
+
+  g_free(threads);
+  g_free(jobs);
+  hanja_dict_unref(dict);
+  g_mapped_file_unref(input);
+  g_free(system_path);
+  g_free(user_path);
+  return status;
+}
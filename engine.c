@@ -1,101 +1,514 @@
 
+#include "config.h"
 #include "hangul.h"
 #include "hanja_dict.h"
+#include "latency.h"
+#include "stats.h"
+#include "trace.h"
+#include <glib-unix.h>
+#include <glib/gstdio.h>
 #include <ibus.h>
-#include <stdarg.h>
+#include <signal.h>
 #include <stdio.h>
 #include <string.h>
 
-static void debug_log(const char *fmt, ...) {
-  // Debug logging disabled for production
-  (void)fmt;
-}
-
 G_DEFINE_AUTOPTR_CLEANUP_FUNC(IBusEngine, g_object_unref)
 
 // --- GObject Boilerplate ---
 #define DKST_TYPE_ENGINE (dkst_engine_get_type())
 G_DECLARE_FINAL_TYPE(DkstEngine, dkst_engine, DKST, ENGINE, IBusEngine)
 
-typedef struct {
-  guint keyval;
-  guint modifiers;
-} ToggleKey;
+// Longest word kept in the preedit in word preedit mode; a longer one is
+// committed in parts
+#define WORD_PREEDIT_MAX 32
+
+// Most text one key can commit or put in the preedit as UTF-8: a preedit
+// word, what the key completed and the composing syllable (codepoints are
+// at most 4 bytes)
+#define TEXT_UTF8_SIZE ((WORD_PREEDIT_MAX + DKST_HANGUL_MAX_COMMIT + 1) * 4 + 1)
+
+// Committed codepoints remembered for Hanja conversion, a power of two
+#define HISTORY_SIZE 32
+#define HISTORY_BOUNDARY 0 // Marks where a word ended in history
+
+// Most dictionary words offered for one conversion (e.g. "대한민국",
+// "민국" and "국" when converting after "우리대한민국"). With more, the
+// longest ones and the shortest (the last syllable's) are offered.
+#define HANJA_MAX_MATCHES 8
+
+// What the client was last sent as preedit, so unchanged updates are skipped
+typedef enum {
+  PREEDIT_UNKNOWN, // Focus moved; the client may have dropped it
+  PREEDIT_HIDDEN,
+  PREEDIT_COMPOSING, // preedit_sent holds the codepoints
+  PREEDIT_INDICATOR_HANGUL,
+  PREEDIT_INDICATOR_ENGLISH,
+} PreeditState;
 
 struct _DkstEngine {
   IBusEngine parent;
 
   DKSTHangul hangul;
+  uint32_t hangul_commit[DKST_HANGUL_MAX_COMMIT]; // Drained after every key
   IBusLookupTable *table;
   gboolean is_hangul_mode;
 
-  // Settings
-  GHashTable *shift_mappings;
-  gboolean enable_custom_shift;
-  gboolean enable_moa_jjiki;
+  // Word preedit mode (config->word_preedit): syllables finished since the
+  // last word boundary. They stay in the preedit ahead of the composing
+  // syllable and are committed with it in one go.
+  uint32_t word[WORD_PREEDIT_MAX];
+  guint word_len;
 
-  // Toggle Keys
-  GList *toggle_keys;
+  // Recently committed codepoints, so a word committed syllable by syllable
+  // can still be converted to Hanja as a whole. A ring: the newest entry
+  // is at history_end - 1 (mod HISTORY_SIZE) and older ones are overwritten.
+  // Starts out all boundaries.
+  uint32_t history[HISTORY_SIZE];
+  guint history_end;
+
+  // Settings, pinned since the last focus-in
+  DkstConfig *config;
 
   // Indicator
   guint indicator_timeout_id;
   gboolean showing_indicator;
-  gboolean enable_indicator;
+
+  // Last preedit sent to the client
+  PreeditState preedit_state;
+  uint32_t preedit_sent[WORD_PREEDIT_MAX + 1];
+  guint preedit_sent_len;
+
+  // Texts reused for every preedit update and commit while typing. Their
+  // strings are the buffers below, so sending one allocates nothing.
+  IBusText *preedit_text; // Attributes cover the whole text
+  IBusText *commit_text;
+  gchar preedit_utf8[TEXT_UTF8_SIZE];
+  gchar commit_utf8[TEXT_UTF8_SIZE];
 
   // Properties (persistent references for IBus panel updates)
   IBusPropList *prop_list;
   IBusProperty *prop_input_mode;
+  gboolean prop_hangul_mode; // Mode prop_input_mode describes
 
   // Hanja feature
-  gboolean hanja_mode;         // True when showing hanja candidates
-  GPtrArray *hanja_candidates; // Current candidate list
-  gchar *hanja_source;         // Original hangul being converted
-  GList *hanja_keys;           // Configurable hanja trigger keys
-  gchar *word_buffer;          // Buffer for multi-char word conversion
+  gboolean hanja_mode;  // True when showing hanja candidates
+  HanjaDict *hanja_dict; // Snapshot pinned while candidates are shown
+  // Dictionary words ending at the cursor, longest first (borrowed views)
+  HanjaCandidates hanja_matches[HANJA_MAX_MATCHES];
+  guint n_hanja_matches;        // Views in hanja_matches
+  guint n_hanja_candidates;     // Entries offered
+  guint hanja_cursor;           // Entry the cursor is on
+  guint hanja_page_start;       // First entry in the table, which holds
+                                // only the page shown (G_MAXUINT if empty)
+  guint hanja_preedit_len;      // Trailing characters of the matches that
+                                // are still in the preedit
+  gchar *hanja_source;          // Text the matches point into
+  gboolean hanja_loading_shown; // "Loading" notice shown in aux text
+
+  DkstLatencyClass key_class; // What the key being processed did
 };
 
-// Static hanja dictionary (shared across all engine instances)
-static HanjaDict g_hanja_dict = {NULL, NULL};
-static gboolean g_hanja_dict_loaded = FALSE;
+// Current hanja dictionary snapshot (shared across all engine instances).
+// Snapshots are immutable and built on worker threads. The first one is
+// published under g_hanja_dict_lock so a Hanja key press can wait for it;
+// later ones replace it with an atomic pointer swap on the main loop, the
+// same thread that pins snapshots, so a reader never sees a freed one.
+static HanjaDict *g_hanja_dict = NULL;
+static gboolean g_hanja_dict_loading = FALSE;
+static gboolean g_user_dict_reloading = FALSE;
+static gboolean g_user_dict_reload_again = FALSE;
+static GMutex g_hanja_dict_lock;
+static GCond g_hanja_dict_ready;
+
+// How long a Hanja key press waits for a dictionary that is still loading
+#define HANJA_LOAD_WAIT_MS 150
+
+// Editors save in several writes; reload once the file has been quiet this long
+#define HANJA_USER_RELOAD_DELAY_MS 100
+
+// Watches the user dictionary so edits apply without restarting IBus
+static GFileMonitor *g_user_dict_monitor = NULL;
+static guint g_user_dict_reload_id = 0;
+
+
+static void load_hanja_dict_thread(GTask *task, gpointer source_object,
+                                   gpointer task_data,
+                                   GCancellable *cancellable) {
+  gint64 start = g_get_monotonic_time();
+  gchar *user_path = hanja_dict_user_path();
+  HanjaDict *dict = hanja_dict_new(hanja_dict_system_path(), user_path);
+  g_free(user_path);
+
+  g_mutex_lock(&g_hanja_dict_lock);
+  g_atomic_pointer_set(&g_hanja_dict, dict);
+  g_cond_broadcast(&g_hanja_dict_ready);
+  g_mutex_unlock(&g_hanja_dict_lock);
+
+  dkst_trace(DKST_TRACE_DICT_LOADED, g_get_monotonic_time() - start, 0, 0);
+  g_task_return_boolean(task, TRUE);
+}
+
+// Runs on the main loop once the first snapshot is published
+static void on_hanja_dict_loaded(GObject *source_object, GAsyncResult *res,
+                                 gpointer user_data) {
+  hanja_dict_get_info(g_atomic_pointer_get(&g_hanja_dict), &dkst_stats.dict);
+}
+
+static void build_user_snapshot_thread(GTask *task, gpointer source_object,
+                                      gpointer task_data,
+                                      GCancellable *cancellable) {
+  gint64 start = g_get_monotonic_time();
+  gchar *user_path = hanja_dict_user_path();
+  HanjaDict *dict = hanja_dict_new_with_user(task_data, user_path);
+  g_free(user_path);
+
+  dkst_trace(DKST_TRACE_USER_DICT_REBUILT, g_get_monotonic_time() - start, 0,
+             0);
+  g_task_return_pointer(task, dict, (GDestroyNotify)hanja_dict_unref);
+}
+
+static void start_user_dict_reload(void);
+
+// Runs on the main loop: publish the new snapshot. Engines still showing
+// candidates keep the old one pinned until they hide them.
+static void on_user_snapshot_built(GObject *source_object, GAsyncResult *res,
+                                   gpointer user_data) {
+  HanjaDict *dict = g_task_propagate_pointer(G_TASK(res), NULL);
+  HanjaDict *old = g_atomic_pointer_get(&g_hanja_dict);
+  g_atomic_pointer_set(&g_hanja_dict, dict);
+  hanja_dict_unref(old);
+  hanja_dict_get_info(dict, &dkst_stats.dict);
+  dkst_stats.user_dict_reloads++;
+
+  g_user_dict_reloading = FALSE;
+  if (g_user_dict_reload_again) {
+    g_user_dict_reload_again = FALSE;
+    start_user_dict_reload();
+  }
+}
+
+// Rebuild only the user table on a worker thread; the new snapshot shares
+// the system dictionary of the current one
+static void start_user_dict_reload(void) {
+  if (g_user_dict_reloading) {
+    // Pick up edits made while a rebuild is already running
+    g_user_dict_reload_again = TRUE;
+    return;
+  }
+  g_user_dict_reloading = TRUE;
+
+  HanjaDict *base = hanja_dict_ref(g_atomic_pointer_get(&g_hanja_dict));
+  GTask *task = g_task_new(NULL, NULL, on_user_snapshot_built, NULL);
+  g_task_set_task_data(task, base, (GDestroyNotify)hanja_dict_unref);
+  g_task_run_in_thread(task, build_user_snapshot_thread);
+  g_object_unref(task);
+}
+
+// Reload once the user dictionary has settled
+static gboolean on_user_dict_reload(gpointer user_data) {
+  if (!g_atomic_pointer_get(&g_hanja_dict)) {
+    // Still loading; the loader may have read the old file, so retry
+    return G_SOURCE_CONTINUE;
+  }
+
+  start_user_dict_reload();
+  g_user_dict_reload_id = 0;
+  return G_SOURCE_REMOVE;
+}
+
+// Whether a monitor event can mean the watched file has new contents
+static gboolean is_content_change(GFileMonitorEvent event) {
+  switch (event) {
+  case G_FILE_MONITOR_EVENT_CHANGED:
+  case G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT:
+  case G_FILE_MONITOR_EVENT_CREATED:
+  case G_FILE_MONITOR_EVENT_DELETED:
+  case G_FILE_MONITOR_EVENT_MOVED_IN:
+  case G_FILE_MONITOR_EVENT_RENAMED:
+    return TRUE;
+  default:
+    return FALSE;
+  }
+}
+
+static void on_user_dict_changed(GFileMonitor *monitor, GFile *file,
+                                 GFile *other_file, GFileMonitorEvent event,
+                                 gpointer user_data) {
+  if (!is_content_change(event))
+    return;
+
+  // Restart the quiet period on every event
+  if (g_user_dict_reload_id)
+    g_source_remove(g_user_dict_reload_id);
+  g_user_dict_reload_id = g_timeout_add(HANJA_USER_RELOAD_DELAY_MS,
+                                        on_user_dict_reload, NULL);
+}
+
+static void watch_user_dict(void) {
+  gchar *user_path = hanja_dict_user_path();
+  GFile *file = g_file_new_for_path(user_path);
+  GError *error = NULL;
+
+  // Works even if the file (or its directory) does not exist yet
+  g_user_dict_monitor =
+      g_file_monitor_file(file, G_FILE_MONITOR_WATCH_MOVES, NULL, &error);
+  if (g_user_dict_monitor) {
+    g_signal_connect(g_user_dict_monitor, "changed",
+                     G_CALLBACK(on_user_dict_changed), NULL);
+  } else {
+    dkst_trace(DKST_TRACE_WATCH_FAILED, error->code, 0, 0);
+    g_error_free(error);
+  }
+
+  g_object_unref(file);
+  g_free(user_path);
+}
+
+// Start loading the dictionary in the background (once, shared). Engine
+// instantiation never blocks on it; Hangul composition works immediately.
+static void start_hanja_dict_load(void) {
+  if (g_hanja_dict_loading)
+    return;
+  g_hanja_dict_loading = TRUE;
+
+  GTask *task = g_task_new(NULL, NULL, on_hanja_dict_loaded, NULL);
+  g_task_run_in_thread(task, load_hanja_dict_thread);
+  g_object_unref(task);
+
+  watch_user_dict();
+}
+
+// Pin the current dictionary snapshot, waiting at most timeout_ms for the
+// initial load. Returns a new reference, or NULL if it is still loading.
+static HanjaDict *get_hanja_dict(guint timeout_ms) {
+  HanjaDict *dict = g_atomic_pointer_get(&g_hanja_dict);
+  if (dict)
+    return hanja_dict_ref(dict);
+
+  gint64 deadline =
+      g_get_monotonic_time() + timeout_ms * G_TIME_SPAN_MILLISECOND;
+  g_mutex_lock(&g_hanja_dict_lock);
+  while (!g_hanja_dict) {
+    if (!g_cond_wait_until(&g_hanja_dict_ready, &g_hanja_dict_lock, deadline))
+      break;
+  }
+  dict = g_hanja_dict ? hanja_dict_ref(g_hanja_dict) : NULL;
+  g_mutex_unlock(&g_hanja_dict_lock);
+  return dict;
+}
 
 G_DEFINE_TYPE(DkstEngine, dkst_engine, IBUS_TYPE_ENGINE)
 
+// Current settings snapshot (shared across all engine instances). It is
+// parsed once and replaced on the main loop only when config.ini changes;
+// engines move to the new one on their next focus-in.
+static DkstConfig *g_config = NULL;
+static GFileMonitor *g_config_monitor = NULL;
+static guint g_config_reload_id = 0;
+
+// setup.py may save in several writes; reload once it has been quiet
+#define CONFIG_RELOAD_DELAY_MS 100
+
+static gchar *config_path(void) {
+  return g_build_filename(g_get_user_config_dir(), "ibus-dkst", "config.ini",
+                          NULL);
+}
+
+static void reload_config(void) {
+  gchar *path = config_path();
+  DkstConfig *old = g_config;
+  g_config = dkst_config_load(path);
+  dkst_config_unref(old);
+  dkst_stats.config_loads++;
+  g_free(path);
+}
+
+static gboolean on_config_reload(gpointer user_data) {
+  reload_config();
+  g_config_reload_id = 0;
+  return G_SOURCE_REMOVE;
+}
+
+static void on_config_changed(GFileMonitor *monitor, GFile *file,
+                              GFile *other_file, GFileMonitorEvent event,
+                              gpointer user_data) {
+  if (!is_content_change(event))
+    return;
+
+  // Restart the quiet period on every event
+  if (g_config_reload_id)
+    g_source_remove(g_config_reload_id);
+  g_config_reload_id =
+      g_timeout_add(CONFIG_RELOAD_DELAY_MS, on_config_reload, NULL);
+}
+
+// The current settings, loading them and watching config.ini on first use
+static DkstConfig *get_config(void) {
+  if (g_config)
+    return g_config;
+
+  reload_config();
+
+  gchar *path = config_path();
+  GFile *file = g_file_new_for_path(path);
+  GError *error = NULL;
+  // Works even if the file (or its directory) does not exist yet
+  g_config_monitor =
+      g_file_monitor_file(file, G_FILE_MONITOR_WATCH_MOVES, NULL, &error);
+  if (g_config_monitor) {
+    g_signal_connect(g_config_monitor, "changed",
+                     G_CALLBACK(on_config_changed), NULL);
+  } else {
+    dkst_trace(DKST_TRACE_WATCH_FAILED, error->code, 0, 0);
+    g_error_free(error);
+  }
+  g_object_unref(file);
+  g_free(path);
+  return g_config;
+}
+
+// Move to the current settings snapshot if it changed since the engine
+// last looked
+static void apply_config(DkstEngine *engine) {
+  DkstConfig *config = get_config();
+  if (engine->config == config)
+    return;
+
+  dkst_config_unref(engine->config);
+  engine->config = dkst_config_ref(config);
+  engine->hangul.moa_jjiki_enabled = config->enable_moa_jjiki;
+  engine->hangul.backspace_mode = config->backspace_mode;
+  dkst_hangul_set_layout(&engine->hangul, config->layout);
+}
+
+// Texts that depend only on the input mode, built once and shared by all
+// engines. IBus never modifies a text it is given, and takes a reference
+// when it keeps one.
+typedef struct {
+  IBusText *symbol;
+  IBusText *label;
+  IBusText *tooltip;
+  IBusText *indicator; // Preedit shown briefly after a toggle
+} ModeTexts;
+
+static ModeTexts g_mode_texts[2]; // English, Hangul
+
+static IBusText *new_shared_text(const char *str) {
+  IBusText *text = ibus_text_new_from_string(str);
+  g_object_ref_sink(text);
+  return text;
+}
+
+static const ModeTexts *mode_texts(gboolean hangul_mode) {
+  ModeTexts *texts = &g_mode_texts[hangul_mode ? 1 : 0];
+  if (texts->symbol)
+    return texts;
+
+  if (hangul_mode) {
+    texts->symbol = new_shared_text("한");
+    texts->label = new_shared_text("한글 모드 (Hangul)");
+    texts->tooltip = new_shared_text(
+        "현재 한글 입력 모드입니다. 클릭하면 영문 모드로 전환합니다.");
+  } else {
+    texts->symbol = new_shared_text("A");
+    texts->label = new_shared_text("영문 모드 (English)");
+    texts->tooltip = new_shared_text(
+        "현재 영문 입력 모드입니다. 클릭하면 한글 모드로 전환합니다.");
+  }
+  texts->indicator = new_shared_text(hangul_mode ? "한" : "A");
+  ibus_text_set_attributes(texts->indicator, ibus_attr_list_new());
+  return texts;
+}
+
+static void history_append(DkstEngine *engine, uint32_t c) {
+  engine->history[engine->history_end++ & (HISTORY_SIZE - 1)] = c;
+}
+
+// Codepoint n places back from the newest (0 is the newest)
+static uint32_t history_at(const DkstEngine *engine, guint n) {
+  return engine->history[(engine->history_end - 1 - n) & (HISTORY_SIZE - 1)];
+}
+
+// End the word in history; Hanja conversion does not reach past this
+static void history_mark_boundary(DkstEngine *engine) {
+  if (history_at(engine, 0) != HISTORY_BOUNDARY)
+    history_append(engine, HISTORY_BOUNDARY);
+}
+
+// The application deleted the last committed character. A boundary stays,
+// as it is not known what it stood for.
+static void history_drop_last(DkstEngine *engine) {
+  if (history_at(engine, 0) == HISTORY_BOUNDARY)
+    return;
+  // Blank the slot so the ring, now one shorter, ends at a boundary
+  engine->history[--engine->history_end & (HISTORY_SIZE - 1)] =
+      HISTORY_BOUNDARY;
+}
+
+// Codepoints committed since the last boundary (all of the ring at most)
+static guint history_word_len(const DkstEngine *engine) {
+  guint n = 0;
+  while (n < HISTORY_SIZE && history_at(engine, n) != HISTORY_BOUNDARY)
+    n++;
+  return n;
+}
+
 static void dkst_engine_init(DkstEngine *engine) {
-  dkst_hangul_init(&engine->hangul);
+  dkst_stats.engines_created++;
+  dkst_stats.engines_live++;
+
+  dkst_hangul_init(&engine->hangul, engine->hangul_commit,
+                   G_N_ELEMENTS(engine->hangul_commit));
 
   // Create lookup table and sink the floating reference
   engine->table = ibus_lookup_table_new(10, 0, TRUE, TRUE);
   g_object_ref_sink(engine->table);
 
   engine->is_hangul_mode = TRUE;
+  engine->word_len = 0;
+  memset(engine->history, 0, sizeof(engine->history)); // HISTORY_BOUNDARY
+  engine->history_end = 0;
 
-  engine->shift_mappings =
-      g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
-  engine->enable_custom_shift = FALSE;
-  engine->enable_moa_jjiki = TRUE;
-
-  engine->toggle_keys = NULL;
+  engine->config = NULL;
+  apply_config(engine);
 
   engine->indicator_timeout_id = 0;
   engine->showing_indicator = FALSE;
-  engine->enable_indicator = TRUE;
+  engine->preedit_state = PREEDIT_UNKNOWN;
+
+  engine->preedit_utf8[0] = '\0';
+  engine->preedit_text = ibus_text_new_from_static_string(engine->preedit_utf8);
+  g_object_ref_sink(engine->preedit_text);
+  // IBus drops attributes that end at 0, so these get a placeholder end that
+  // update_preedit() replaces with the length of each preedit
+  ibus_text_set_attributes(engine->preedit_text, ibus_attr_list_new());
+  ibus_text_append_attribute(engine->preedit_text, IBUS_ATTR_TYPE_UNDERLINE,
+                             IBUS_ATTR_UNDERLINE_SINGLE, 0, 1);
+  // Attempt to force visibility in Sublime Text by adding a background color
+  // attribute. Using a neutral light gray (0xDDDDDD). IBUS colors are
+  // typically simple integers (RGB). Note: This might look weird in dark
+  // modes, but we need to verify visibility first. 0x00RRGGBB
+  ibus_text_append_attribute(engine->preedit_text, IBUS_ATTR_TYPE_BACKGROUND,
+                             0x00666666, 0, 1);
+
+  engine->commit_utf8[0] = '\0';
+  engine->commit_text = ibus_text_new_from_static_string(engine->commit_utf8);
+  g_object_ref_sink(engine->commit_text);
 
   // Properties initialization
   engine->prop_list = ibus_prop_list_new();
   g_object_ref_sink(engine->prop_list);
 
   // Create InputMode property (persistent, updated in-place)
+  const ModeTexts *texts = mode_texts(TRUE);
   IBusProperty *prop_input_mode = ibus_property_new(
-      "InputMode", PROP_TYPE_NORMAL,
-      ibus_text_new_from_string("한글 모드 (Hangul)"),
-      "",
-      ibus_text_new_from_string(
-          "현재 한글 입력 모드입니다. 클릭하면 영문 모드로 전환합니다."),
-      TRUE, TRUE, PROP_STATE_UNCHECKED, NULL);
-  ibus_property_set_symbol(prop_input_mode, ibus_text_new_from_string("한"));
+      "InputMode", PROP_TYPE_NORMAL, texts->label, "", texts->tooltip, TRUE,
+      TRUE, PROP_STATE_UNCHECKED, NULL);
+  ibus_property_set_symbol(prop_input_mode, texts->symbol);
   g_object_ref_sink(prop_input_mode);
   ibus_prop_list_append(engine->prop_list, prop_input_mode);
   engine->prop_input_mode = prop_input_mode;
+  engine->prop_hangul_mode = TRUE;
 
   // Settings Property
   IBusProperty *prop_setup = ibus_property_new(
@@ -116,40 +529,33 @@ static void dkst_engine_init(DkstEngine *engine) {
 
   // Hanja feature initialization
   engine->hanja_mode = FALSE;
-  engine->hanja_candidates = NULL;
+  engine->hanja_dict = NULL;
+  engine->n_hanja_matches = 0;
+  engine->n_hanja_candidates = 0;
+  engine->hanja_page_start = G_MAXUINT;
   engine->hanja_source = NULL;
 
-  // Load hanja dictionary (once, shared)
-  if (!g_hanja_dict_loaded) {
-    gchar *user_dict_path = g_build_filename(
-        g_get_user_config_dir(), "ibus-dkst", "hanja_user.txt", NULL);
-    hanja_dict_init(&g_hanja_dict, "/usr/share/ibus-dkst/hanja.txt",
-                    user_dict_path);
-    g_free(user_dict_path);
-    g_hanja_dict_loaded = TRUE;
-  }
-}
+  engine->hanja_loading_shown = FALSE;
 
-static void free_toggle_key(gpointer data) { g_free(data); }
+  // Load hanja dictionary (once, shared) without blocking the main loop
+  start_hanja_dict_load();
+}
 
 static void dkst_engine_finalize(GObject *object) {
   DkstEngine *engine = (DkstEngine *)object;
 
+  dkst_stats.engines_live--;
+
   if (engine->indicator_timeout_id > 0) {
     g_source_remove(engine->indicator_timeout_id);
     engine->indicator_timeout_id = 0;
   }
 
-  dkst_hangul_free(&engine->hangul);
+  dkst_config_unref(engine->config);
+  engine->config = NULL;
 
-  if (engine->shift_mappings) {
-    g_hash_table_destroy(engine->shift_mappings);
-  }
-
-  if (engine->toggle_keys) {
-    g_list_free_full(engine->toggle_keys, free_toggle_key);
-    engine->toggle_keys = NULL;
-  }
+  g_clear_object(&engine->preedit_text);
+  g_clear_object(&engine->commit_text);
 
   // Properties cleanup
   if (engine->prop_input_mode) {
@@ -162,241 +568,84 @@ static void dkst_engine_finalize(GObject *object) {
   }
 
   // Hanja cleanup
-  if (engine->hanja_candidates) {
-    g_ptr_array_unref(engine->hanja_candidates);
-    engine->hanja_candidates = NULL;
-  }
   if (engine->hanja_source) {
     g_free(engine->hanja_source);
     engine->hanja_source = NULL;
   }
+  if (engine->hanja_dict) {
+    hanja_dict_unref(engine->hanja_dict);
+    engine->hanja_dict = NULL;
+  }
 
   G_OBJECT_CLASS(dkst_engine_parent_class)->finalize(object);
 }
 
-// Helper to parse key string like "Shift+space"
-static void add_toggle_key(DkstEngine *engine, const gchar *keystr) {
-  guint keyval = 0;
-  guint modifiers = 0;
-
-  // Split by '+'
-  gchar **parts = g_strsplit(keystr, "+", -1);
-  guint len = g_strv_length(parts);
-
-  if (len > 0) {
-    // Last part is key name
-    keyval = ibus_keyval_from_name(parts[len - 1]);
-
-    // Previous parts are modifiers
-    for (guint i = 0; i < len - 1; i++) {
-      if (g_ascii_strcasecmp(parts[i], "Shift") == 0)
-        modifiers |= IBUS_SHIFT_MASK;
-      else if (g_ascii_strcasecmp(parts[i], "Control") == 0)
-        modifiers |= IBUS_CONTROL_MASK;
-      else if (g_ascii_strcasecmp(parts[i], "Alt") == 0)
-        modifiers |= IBUS_MOD1_MASK; // Alt is usually Mod1
-      else if (g_ascii_strcasecmp(parts[i], "Super") == 0)
-        modifiers |= IBUS_SUPER_MASK;
-      else if (g_ascii_strcasecmp(parts[i], "Meta") == 0)
-        modifiers |= IBUS_META_MASK;
-    }
-  }
-  g_strfreev(parts);
-
-  if (keyval != 0) {
-    ToggleKey *tk = g_new(ToggleKey, 1);
-    tk->keyval = keyval;
-    tk->modifiers = modifiers;
-    engine->toggle_keys = g_list_append(engine->toggle_keys, tk);
-    debug_log("Added Toggle Key: Val=%x Mods=%x (from %s)\n", keyval, modifiers,
-              keystr);
-  }
-}
-
-// Helper to parse hanja key string like "Alt+Return"
-static void add_hanja_key(DkstEngine *engine, const gchar *keystr) {
-  guint keyval = 0;
-  guint modifiers = 0;
-
-  // Split by '+'
-  gchar **parts = g_strsplit(keystr, "+", -1);
-  guint len = g_strv_length(parts);
-
-  if (len > 0) {
-    // Last part is key name
-    keyval = ibus_keyval_from_name(parts[len - 1]);
-
-    // Previous parts are modifiers
-    for (guint i = 0; i < len - 1; i++) {
-      if (g_ascii_strcasecmp(parts[i], "Shift") == 0)
-        modifiers |= IBUS_SHIFT_MASK;
-      else if (g_ascii_strcasecmp(parts[i], "Control") == 0)
-        modifiers |= IBUS_CONTROL_MASK;
-      else if (g_ascii_strcasecmp(parts[i], "Alt") == 0)
-        modifiers |= IBUS_MOD1_MASK;
-      else if (g_ascii_strcasecmp(parts[i], "Super") == 0)
-        modifiers |= IBUS_SUPER_MASK;
-      else if (g_ascii_strcasecmp(parts[i], "Meta") == 0)
-        modifiers |= IBUS_META_MASK;
-    }
-  }
-  g_strfreev(parts);
-
-  if (keyval != 0) {
-    ToggleKey *hk = g_new(ToggleKey, 1);
-    hk->keyval = keyval;
-    hk->modifiers = modifiers;
-    engine->hanja_keys = g_list_append(engine->hanja_keys, hk);
-    debug_log("Added Hanja Key: Val=%x Mods=%x (from %s)\n", keyval, modifiers,
-              keystr);
+static void hide_preedit(DkstEngine *engine) {
+  if (engine->preedit_state == PREEDIT_HIDDEN) {
+    dkst_stats.preedit_updates_skipped++;
+    return;
   }
+  engine->preedit_state = PREEDIT_HIDDEN;
+  dkst_stats.preedit_updates++;
+  ibus_engine_hide_preedit_text((IBusEngine *)engine);
 }
 
-static void load_config(DkstEngine *engine) {
-  gchar *config_path = g_build_filename(g_get_user_config_dir(), "ibus-dkst",
-                                        "config.ini", NULL);
-  GKeyFile *key_file = g_key_file_new();
-
-  // Clear existing toggle keys before loading
-  if (engine->toggle_keys) {
-    g_list_free_full(engine->toggle_keys, free_toggle_key);
-    engine->toggle_keys = NULL;
-  }
-
-  if (g_key_file_load_from_file(key_file, config_path, G_KEY_FILE_NONE, NULL)) {
-    // Moa-jjik-gi
-    if (g_key_file_has_key(key_file, "Settings", "EnableMoaJjiki", NULL)) {
-      engine->enable_moa_jjiki =
-          g_key_file_get_boolean(key_file, "Settings", "EnableMoaJjiki", NULL);
-      engine->hangul.moa_jjiki_enabled = engine->enable_moa_jjiki;
-    }
-
-    // Backspace Mode
-    if (g_key_file_has_key(key_file, "Settings", "BackspaceMode", NULL)) {
-      gchar *mode_str =
-          g_key_file_get_string(key_file, "Settings", "BackspaceMode", NULL);
-      if (g_strcmp0(mode_str, "CHAR") == 0) {
-        engine->hangul.backspace_mode = DKST_BACKSPACE_CHAR;
-      } else {
-        engine->hangul.backspace_mode = DKST_BACKSPACE_JASO;
-      }
-      g_free(mode_str);
-    }
-
-    // Indicator
-    if (g_key_file_has_key(key_file, "Settings", "EnableIndicator", NULL)) {
-      engine->enable_indicator =
-          g_key_file_get_boolean(key_file, "Settings", "EnableIndicator", NULL);
-    }
-
-    // Custom Shift
-    if (g_key_file_has_key(key_file, "Settings", "EnableCustomShift", NULL)) {
-      engine->enable_custom_shift = g_key_file_get_boolean(
-          key_file, "Settings", "EnableCustomShift", NULL);
-    }
-
-    // Toggle Keys
-    if (g_key_file_has_key(key_file, "ToggleKeys", "Keys", NULL)) {
-      gchar *keys_str =
-          g_key_file_get_string(key_file, "ToggleKeys", "Keys", NULL);
-      if (keys_str) {
-        gchar **keys = g_strsplit(keys_str, ";", -1);
-        for (int i = 0; keys[i] != NULL; i++) {
-          if (strlen(keys[i]) > 0) {
-            add_toggle_key(engine, keys[i]);
-          }
-        }
-        g_strfreev(keys);
-        g_free(keys_str);
-      }
-    }
-
-    // Hanja Keys
-    if (engine->hanja_keys) {
-      g_list_free_full(engine->hanja_keys, free_toggle_key);
-      engine->hanja_keys = NULL;
-    }
-    if (g_key_file_has_key(key_file, "HanjaKeys", "Keys", NULL)) {
-      gchar *keys_str =
-          g_key_file_get_string(key_file, "HanjaKeys", "Keys", NULL);
-      if (keys_str) {
-        gchar **keys = g_strsplit(keys_str, ";", -1);
-        for (int i = 0; keys[i] != NULL; i++) {
-          if (strlen(keys[i]) > 0) {
-            add_hanja_key(engine, keys[i]);
-          }
-        }
-        g_strfreev(keys);
-        g_free(keys_str);
-      }
-    }
-
-    // Load Mappings
-    g_hash_table_remove_all(engine->shift_mappings);
-    if (engine->enable_custom_shift) {
-      gsize length = 0;
-      gchar **keys =
-          g_key_file_get_keys(key_file, "CustomShift", &length, NULL);
-      if (keys) {
-        for (gsize i = 0; i < length; i++) {
-          gchar *val =
-              g_key_file_get_string(key_file, "CustomShift", keys[i], NULL);
-          if (val) {
-            g_hash_table_insert(engine->shift_mappings, g_strdup(keys[i]), val);
-          }
-        }
-        g_strfreev(keys);
-      }
-    }
-
-    debug_log("Config Loaded: Moa=%d, Backspace=%d, Shift=%d\n",
-              engine->enable_moa_jjiki, engine->hangul.backspace_mode,
-              engine->enable_custom_shift);
-  }
-
-  // Fallback if no toggle keys loaded? Add defaults.
-  if (engine->toggle_keys == NULL) {
-    add_toggle_key(engine, "Shift+space");
-    add_toggle_key(engine, "Hangul");
-  }
-
-  // Fallback if no hanja keys loaded? Add defaults.
-  if (engine->hanja_keys == NULL) {
-    add_hanja_key(engine, "Alt+Return");
-    add_hanja_key(engine, "Hangul_Hanja");
-  }
-
-  g_key_file_free(key_file);
-  g_free(config_path);
+// Whether the client already shows the word and syllable as preedit
+static gboolean preedit_sent(DkstEngine *engine, uint32_t syl) {
+  guint len = engine->word_len;
+  return engine->preedit_state == PREEDIT_COMPOSING &&
+         engine->preedit_sent_len == len + (syl > 0) &&
+         memcmp(engine->preedit_sent, engine->word, len * sizeof(uint32_t)) ==
+             0 &&
+         (syl == 0 || engine->preedit_sent[len] == syl);
 }
 
-// Helper to update preedit text
+// Helper to update preedit text. Sends nothing if the client already shows
+// what it should.
 static void update_preedit(DkstEngine *engine) {
   uint32_t syl = dkst_hangul_current_syllable(&engine->hangul);
-  if (syl > 0) {
-    IBusText *text = ibus_text_new_from_unichar(syl);
-    ibus_text_set_attributes(text, ibus_attr_list_new());
-    ibus_text_append_attribute(text, IBUS_ATTR_TYPE_UNDERLINE,
-                               IBUS_ATTR_UNDERLINE_SINGLE, 0,
-                               ibus_text_get_length(text));
-
-    // Attempt to force visibility in Sublime Text by adding a background color
-    // attribute. Using a neutral light gray (0xDDDDDD). IBUS colors are
-    // typically simple integers (RGB). Note: This might look weird in dark
-    // modes, but we need to verify visibility first. 0x00RRGGBB
-    ibus_text_append_attribute(text, IBUS_ATTR_TYPE_BACKGROUND, 0x00666666, 0,
-                               ibus_text_get_length(text));
+  if (syl > 0 || engine->word_len > 0) {
+    if (preedit_sent(engine, syl)) {
+      dkst_stats.preedit_updates_skipped++;
+      return;
+    }
+    engine->preedit_state = PREEDIT_COMPOSING;
+    memcpy(engine->preedit_sent, engine->word,
+           engine->word_len * sizeof(uint32_t));
+    engine->preedit_sent_len = engine->word_len;
+    if (syl > 0)
+      engine->preedit_sent[engine->preedit_sent_len++] = syl;
+    dkst_stats.preedit_updates++;
+
+    // Rewrite the reusable preedit text in place
+    guint n_chars = engine->preedit_sent_len;
+    gsize len = 0;
+    for (guint i = 0; i < n_chars; i++)
+      len += g_unichar_to_utf8(engine->preedit_sent[i],
+                               engine->preedit_utf8 + len);
+    engine->preedit_utf8[len] = '\0';
+    IBusAttrList *attrs = ibus_text_get_attributes(engine->preedit_text);
+    IBusAttribute *attr;
+    for (guint i = 0; (attr = ibus_attr_list_get(attrs, i)) != NULL; i++)
+      attr->end_index = n_chars;
 
     // Use PREEDIT_COMMIT mode to ensure text stays at original position if
     // committed automatically
-    ibus_engine_update_preedit_text_with_mode((IBusEngine *)engine, text,
-                                              ibus_text_get_length(text), TRUE,
-                                              IBUS_ENGINE_PREEDIT_COMMIT);
+    ibus_engine_update_preedit_text_with_mode((IBusEngine *)engine,
+                                              engine->preedit_text, n_chars,
+                                              TRUE, IBUS_ENGINE_PREEDIT_COMMIT);
   } else if (engine->showing_indicator) {
     // Show "한" or "EN"
-    const char *indicator_str = engine->is_hangul_mode ? "한" : "A";
-    IBusText *text = ibus_text_new_from_string(indicator_str);
-    ibus_text_set_attributes(text, ibus_attr_list_new());
+    PreeditState state = engine->is_hangul_mode ? PREEDIT_INDICATOR_HANGUL
+                                                : PREEDIT_INDICATOR_ENGLISH;
+    if (engine->preedit_state == state) {
+      dkst_stats.preedit_updates_skipped++;
+      return;
+    }
+    engine->preedit_state = state;
+    dkst_stats.preedit_updates++;
+
+    IBusText *text = mode_texts(engine->is_hangul_mode)->indicator;
     // Use a different color or style for indicator?
     // Maybe just underline for now to be safe.
     // ibus_text_append_attribute(text, IBUS_ATTR_TYPE_FOREGROUND, 0x0000FF00,
@@ -407,30 +656,34 @@ static void update_preedit(DkstEngine *engine) {
                                               ibus_text_get_length(text), TRUE,
                                               IBUS_ENGINE_PREEDIT_CLEAR);
   } else {
-    ibus_engine_hide_preedit_text((IBusEngine *)engine);
+    hide_preedit(engine);
   }
 }
 
-static void update_language_property(DkstEngine *engine) {
+// Make the InputMode property describe the current mode. Returns FALSE if
+// it already did.
+static gboolean set_language_property(DkstEngine *engine) {
   IBusProperty *prop = engine->prop_input_mode;
-  if (prop == NULL)
-    return;
-
-  const char *symbol_str = engine->is_hangul_mode ? "한" : "A";
-  const char *label_str =
-      engine->is_hangul_mode ? "한글 모드 (Hangul)" : "영문 모드 (English)";
-  const char *tooltip_str =
-      engine->is_hangul_mode
-          ? "현재 한글 입력 모드입니다. 클릭하면 영문 모드로 전환합니다."
-          : "현재 영문 입력 모드입니다. 클릭하면 한글 모드로 전환합니다.";
+  if (prop == NULL || engine->prop_hangul_mode == engine->is_hangul_mode)
+    return FALSE;
 
   // Update the existing property in-place (IBus requires the same object)
-  ibus_property_set_symbol(prop, ibus_text_new_from_string(symbol_str));
+  const ModeTexts *texts = mode_texts(engine->is_hangul_mode);
+  ibus_property_set_symbol(prop, texts->symbol);
   ibus_property_set_icon(prop, "");
-  ibus_property_set_label(prop, ibus_text_new_from_string(label_str));
-  ibus_property_set_tooltip(prop, ibus_text_new_from_string(tooltip_str));
+  ibus_property_set_label(prop, texts->label);
+  ibus_property_set_tooltip(prop, texts->tooltip);
+  engine->prop_hangul_mode = engine->is_hangul_mode;
+  return TRUE;
+}
 
-  ibus_engine_update_property((IBusEngine *)engine, prop);
+static void update_language_property(DkstEngine *engine) {
+  if (!set_language_property(engine)) {
+    dkst_stats.property_updates_skipped++;
+    return;
+  }
+  dkst_stats.property_updates++;
+  ibus_engine_update_property((IBusEngine *)engine, engine->prop_input_mode);
 }
 
 static void clear_indicator(DkstEngine *engine) {
@@ -458,7 +711,7 @@ static gboolean on_indicator_timeout(gpointer data) {
 static void show_indicator(DkstEngine *engine) {
   update_language_property(engine);
 
-  if (!engine->enable_indicator)
+  if (!engine->config->enable_indicator)
     return;
 
   if (engine->indicator_timeout_id > 0) {
@@ -475,148 +728,300 @@ static void show_indicator(DkstEngine *engine) {
 static void commit_string(DkstEngine *engine, const char *str);
 
 // --- Hanja Feature ---
+
+// Without surrounding text support, committed text cannot be deleted, so
+// conversion covers only what is still in the preedit
+static gboolean can_replace_committed(DkstEngine *engine) {
+  return (((IBusEngine *)engine)->client_capabilities &
+          IBUS_CAP_SURROUNDING_TEXT) != 0;
+}
+
 static void hide_hanja_candidates(DkstEngine *engine) {
   if (engine->hanja_mode) {
     engine->hanja_mode = FALSE;
     ibus_engine_hide_lookup_table((IBusEngine *)engine);
+    ibus_engine_hide_auxiliary_text((IBusEngine *)engine);
     ibus_lookup_table_clear(engine->table);
   }
-  if (engine->hanja_candidates) {
-    g_ptr_array_unref(engine->hanja_candidates);
-    engine->hanja_candidates = NULL;
-  }
+  engine->n_hanja_matches = 0;
+  engine->n_hanja_candidates = 0;
+  engine->hanja_page_start = G_MAXUINT;
   if (engine->hanja_source) {
     g_free(engine->hanja_source);
     engine->hanja_source = NULL;
   }
+  if (engine->hanja_dict) {
+    hanja_dict_unref(engine->hanja_dict);
+    engine->hanja_dict = NULL;
+  }
+}
+
+// Map a lookup table index to a match and an index within it. Every match
+// lists its dictionary entries, longest first; only the last (shortest) one
+// also offers its original hangul, so it appears once at the end.
+static const HanjaCandidates *hanja_candidate_at(DkstEngine *engine,
+                                                 guint index, guint *local) {
+  for (guint m = 0; m < engine->n_hanja_matches; m++) {
+    const HanjaCandidates *match = &engine->hanja_matches[m];
+    guint n = hanja_candidates_count(match);
+    if (m + 1 < engine->n_hanja_matches)
+      n--;
+    if (index < n) {
+      *local = index;
+      return match;
+    }
+    index -= n;
+  }
+  return NULL;
+}
+
+// Send the page the cursor is on. The table holds that page alone and is
+// refilled only when the cursor leaves it, so neither building the table
+// nor sending it grows with the number of candidates. Since the panel then
+// sees one page, the position in the whole list goes in the auxiliary text.
+static void update_hanja_table(DkstEngine *engine) {
+  guint page_size = ibus_lookup_table_get_page_size(engine->table);
+  guint page_start = engine->hanja_cursor / page_size * page_size;
+
+  if (page_start != engine->hanja_page_start) {
+    ibus_lookup_table_clear(engine->table);
+    for (guint i = page_start;
+         i < page_start + page_size && i < engine->n_hanja_candidates; i++) {
+      guint local;
+      const HanjaCandidates *match = hanja_candidate_at(engine, i, &local);
+      const gchar *candidate = hanja_candidates_get(match, local);
+      const gchar *note = hanja_candidates_get_note(match, local);
+      IBusText *text;
+      if (*note) {
+        // Show "韓 (한국 한)"; only "韓" is committed
+        gchar *label = g_strconcat(candidate, " ", note, NULL);
+        text = ibus_text_new_from_string(label);
+        g_free(label);
+      } else {
+        text = ibus_text_new_from_string(candidate);
+      }
+      ibus_lookup_table_append_candidate(engine->table, text);
+    }
+    engine->hanja_page_start = page_start;
+  }
+
+  ibus_lookup_table_set_cursor_pos(engine->table,
+                                   engine->hanja_cursor - page_start);
+  ibus_engine_update_lookup_table((IBusEngine *)engine, engine->table, TRUE);
+
+  gchar position[32];
+  g_snprintf(position, sizeof(position), "%u / %u", engine->hanja_cursor + 1,
+             engine->n_hanja_candidates);
+  ibus_engine_update_auxiliary_text((IBusEngine *)engine,
+                                    ibus_text_new_from_string(position), TRUE);
+}
+
+// Move the cursor for an arrow or page key, wrapping around at either end
+// as a round lookup table does
+static void move_hanja_cursor(DkstEngine *engine, guint keyval) {
+  guint n = engine->n_hanja_candidates;
+  guint page_size = ibus_lookup_table_get_page_size(engine->table);
+  guint cursor = engine->hanja_cursor;
+
+  switch (keyval) {
+  case IBUS_KEY_Up:
+  case IBUS_KEY_KP_Up:
+    cursor = cursor > 0 ? cursor - 1 : n - 1;
+    break;
+  case IBUS_KEY_Down:
+  case IBUS_KEY_KP_Down:
+    cursor = cursor + 1 < n ? cursor + 1 : 0;
+    break;
+  case IBUS_KEY_Page_Up:
+    if (cursor >= page_size)
+      cursor -= page_size;
+    else // Same place on the last page
+      cursor = MIN((n - 1) / page_size * page_size + cursor, n - 1);
+    break;
+  case IBUS_KEY_Page_Down:
+    if (cursor / page_size < (n - 1) / page_size)
+      cursor = MIN(cursor + page_size, n - 1);
+    else // Same place on the first page
+      cursor %= page_size;
+    break;
+  }
+
+  engine->key_class = DKST_LATENCY_CANDIDATE_MOVE;
+  engine->hanja_cursor = cursor;
+  update_hanja_table(engine);
 }
 
 static void show_hanja_candidates(DkstEngine *engine) {
-  debug_log("show_hanja_candidates: ENTER\n");
+  engine->key_class = DKST_LATENCY_HANJA_OPEN;
 
   // Get current composed text
   uint32_t syl = dkst_hangul_current_syllable(&engine->hangul);
-  debug_log("show_hanja_candidates: syl=%x, word_buffer=%s\n", syl,
-            engine->word_buffer ? engine->word_buffer : "(null)");
 
-  // Build lookup string
-  GString *word = g_string_new("");
-  gchar cur_char[7] = "";
+  // Characters still in the preedit (the word so far in word preedit mode,
+  // then the composing syllable) can always be replaced
+  guint n_preedit = engine->word_len + (syl != 0);
 
-  if (engine->word_buffer && strlen(engine->word_buffer) > 0) {
-    g_string_append(word, engine->word_buffer);
+  // Build lookup string: recent committed text + preedit
+  GString *word = g_string_new("");
+  if (can_replace_committed(engine)) {
+    for (guint n = history_word_len(engine); n > 0; n--) {
+      g_string_append_unichar(word, history_at(engine, n - 1));
+    }
+  }
+  for (guint i = 0; i < engine->word_len; i++) {
+    g_string_append_unichar(word, engine->word[i]);
   }
-
   if (syl != 0) {
-    // Convert current syllable to UTF-8
-    gint cur_len = g_unichar_to_utf8(syl, cur_char);
-    cur_char[cur_len] = '\0';
-    g_string_append(word, cur_char);
+    g_string_append_unichar(word, syl);
   }
 
   // If nothing to look up, return
   if (word->len == 0) {
-    debug_log("show_hanja_candidates: nothing to look up\n");
     g_string_free(word, TRUE);
     return;
   }
 
-  debug_log("show_hanja_candidates: looking up word '%s'\n", word->str);
-
-  // Try word lookup first
-  GPtrArray *candidates = hanja_dict_lookup(&g_hanja_dict, word->str);
-  gboolean is_word_match = FALSE;
-  glong word_len = g_utf8_strlen(word->str, -1);
-
-  // If word is 2+ chars and lookup found results, use word match
-  if (word_len >= 2 && candidates && candidates->len > 0) {
-    is_word_match = TRUE;
-    debug_log(
-        "show_hanja_candidates: word match found (%ld chars), %u candidates\n",
-        word_len, candidates->len);
-  } else if (cur_char[0] != '\0') {
-    // Fall back to single character lookup
-    if (candidates)
-      g_ptr_array_unref(candidates);
-    debug_log("show_hanja_candidates: no word match, trying single char '%s'\n",
-              cur_char);
-    candidates = hanja_dict_lookup(&g_hanja_dict, cur_char);
-  }
-
-  debug_log("show_hanja_candidates: candidates=%p\n", (void *)candidates);
-  if (!candidates || candidates->len == 0) {
-    debug_log("show_hanja_candidates: no candidates found\n");
-    if (candidates)
-      g_ptr_array_unref(candidates);
+  // Wait briefly for a dictionary that is still loading in the background
+  HanjaDict *dict = get_hanja_dict(HANJA_LOAD_WAIT_MS);
+  if (!dict) {
+    dkst_trace(DKST_TRACE_HANJA_NOT_READY, word->len, 0, 0);
+    dkst_stats.hanja_not_ready++;
+    IBusText *notice = ibus_text_new_from_string("한자 사전을 불러오는 중...");
+    ibus_engine_update_auxiliary_text((IBusEngine *)engine, notice, TRUE);
+    engine->hanja_loading_shown = TRUE;
     g_string_free(word, TRUE);
     return;
   }
-  debug_log("show_hanja_candidates: found %u candidates\n", candidates->len);
 
-  // Store source text for later
-  if (is_word_match) {
-    engine->hanja_source = g_strdup(word->str);
-  } else {
-    engine->hanja_source = g_strdup(cur_char);
+  // Find every dictionary word ending at the cursor in one trie walk.
+  // The views borrow hanja_source and the pinned snapshot, both of which
+  // live until the table is hidden.
+  engine->hanja_dict = dict;
+  engine->hanja_source = g_string_free(word, FALSE);
+  engine->hanja_preedit_len = n_preedit;
+  engine->n_hanja_matches =
+      hanja_dict_lookup_suffixes(dict, engine->hanja_source, -1,
+                                 engine->hanja_matches, HANJA_MAX_MATCHES);
+  if (engine->n_hanja_matches > 0)
+    dkst_stats.hanja_hits++;
+  else
+    dkst_stats.hanja_misses++;
+
+  if (engine->n_hanja_matches == 0) {
+    if (n_preedit == 0) {
+      dkst_trace(DKST_TRACE_HANJA_LOOKUP, strlen(engine->hanja_source), 0, 0);
+      g_free(engine->hanja_source);
+      engine->hanja_source = NULL;
+      hanja_dict_unref(engine->hanja_dict);
+      engine->hanja_dict = NULL;
+      return;
+    }
+    // Still offer the last preedit character itself
+    const gchar *cur_char = g_utf8_find_prev_char(
+        engine->hanja_source,
+        engine->hanja_source + strlen(engine->hanja_source));
+    hanja_dict_lookup(dict, cur_char, &engine->hanja_matches[0]);
+    engine->n_hanja_matches = 1;
   }
-  g_string_free(word, TRUE);
-
-  engine->hanja_candidates = candidates;
-  engine->hanja_mode = TRUE;
 
-  // Populate lookup table
-  ibus_lookup_table_clear(engine->table);
-  for (guint i = 0; i < candidates->len; i++) {
-    const gchar *candidate = g_ptr_array_index(candidates, i);
-    IBusText *text = ibus_text_new_from_string(candidate);
-    ibus_lookup_table_append_candidate(engine->table, text);
+  engine->n_hanja_candidates = 0;
+  for (guint m = 0; m < engine->n_hanja_matches; m++) {
+    engine->n_hanja_candidates +=
+        hanja_candidates_count(&engine->hanja_matches[m]);
   }
+  engine->n_hanja_candidates -= engine->n_hanja_matches - 1;
+  dkst_trace(DKST_TRACE_HANJA_LOOKUP, strlen(engine->hanja_source),
+             engine->n_hanja_matches, engine->n_hanja_candidates);
+  engine->hanja_mode = TRUE;
 
-  // Show lookup table
-  debug_log("show_hanja_candidates: showing table with %u entries\n",
-            ibus_lookup_table_get_number_of_candidates(engine->table));
-  ibus_engine_update_lookup_table((IBusEngine *)engine, engine->table, TRUE);
-  debug_log("show_hanja_candidates: EXIT success\n");
+  // Show the first page
+  engine->hanja_cursor = 0;
+  engine->hanja_page_start = G_MAXUINT;
+  update_hanja_table(engine);
 }
 
 static void select_hanja_candidate(DkstEngine *engine, guint index) {
-  if (!engine->hanja_mode || !engine->hanja_candidates)
+  if (!engine->hanja_mode)
     return;
 
-  if (index >= engine->hanja_candidates->len)
+  // Commit text only; annotations were split off at load time
+  guint local;
+  const HanjaCandidates *match = hanja_candidate_at(engine, index, &local);
+  const gchar *selected = match ? hanja_candidates_get(match, local) : NULL;
+  if (!selected)
     return;
 
-  const gchar *selected = g_ptr_array_index(engine->hanja_candidates, index);
-
-  // Extract just the character (before any parenthesis)
-  // Format may be "韓 (한국 한)" - we want just "韓"
-  gchar *commit_str = g_strdup(selected);
-  gchar *space = strchr(commit_str, ' ');
-  if (space)
-    *space = '\0';
+  // The matched word may start in text that was already committed
+  // (e.g. "대한민" committed, "국" composing); replace that part too
+  glong n_matched = g_utf8_strlen(match->hangul, -1);
+  glong n_committed = n_matched - (glong)engine->hanja_preedit_len;
+  if (n_committed > 0) {
+    // Only looked up with the capability; it should not have gone since
+    if (!can_replace_committed(engine))
+      return;
+    ibus_engine_delete_surrounding_text((IBusEngine *)engine,
+                                        -(gint)n_committed, n_committed);
+  }
 
-  // Clear word buffer when hanja is selected (word is replaced)
-  if (engine->word_buffer) {
-    g_free(engine->word_buffer);
-    engine->word_buffer = NULL;
+  // Or it may cover only the end of the preedit word; what comes before it
+  // is committed as it is, ahead of the Hanja
+  GString *text = g_string_new("");
+  for (glong i = 0; i < -n_committed && i < (glong)engine->word_len; i++) {
+    g_string_append_unichar(text, engine->word[i]);
   }
+  g_string_append(text, selected);
+  engine->word_len = 0;
+
+  // The word is replaced; what comes next starts a new one
+  history_mark_boundary(engine);
 
   // Clear composed text
   dkst_hangul_reset(&engine->hangul);
-  ibus_engine_hide_preedit_text((IBusEngine *)engine);
+  hide_preedit(engine);
 
   // Commit selected hanja
-  commit_string(engine, commit_str);
-  g_free(commit_str);
+  commit_string(engine, text->str);
+  g_string_free(text, TRUE);
+  engine->key_class = DKST_LATENCY_CANDIDATE_SELECT;
 
   // Cleanup
   hide_hanja_candidates(engine);
 }
 
+// IBus sinks and drops a floating text once it is sent; the engine's own
+// texts are not floating, so they stay for reuse
+static void send_commit(DkstEngine *engine, IBusText *text, gsize len) {
+  ibus_engine_commit_text((IBusEngine *)engine, text);
+  engine->key_class = DKST_LATENCY_COMMIT;
+  dkst_stats.commits++;
+  dkst_trace(DKST_TRACE_COMMIT, len, 0, 0);
+}
+
+// Commit the len bytes in engine->commit_utf8
+static void commit_buffered(DkstEngine *engine, gsize len) {
+  engine->commit_utf8[len] = '\0';
+  if (len > 0)
+    send_commit(engine, engine->commit_text, len);
+}
+
+// Write the preedit word to engine->commit_utf8 as UTF-8, after the len
+// bytes already there. Returns the new length.
+static gsize word_to_commit_utf8(DkstEngine *engine, gsize len) {
+  for (guint i = 0; i < engine->word_len; i++)
+    len += g_unichar_to_utf8(engine->word[i], engine->commit_utf8 + len);
+  return len;
+}
+
 static void commit_string(DkstEngine *engine, const char *str) {
-  if (str && *str) {
-    IBusText *text = ibus_text_new_from_string(str);
-    ibus_engine_commit_text((IBusEngine *)engine, text);
+  if (!str || !*str)
+    return;
+  gsize len = strlen(str);
+  if (len < sizeof(engine->commit_utf8)) {
+    memcpy(engine->commit_utf8, str, len);
+    commit_buffered(engine, len);
+  } else {
+    // Longer than typing produces (a custom Shift text, say)
+    send_commit(engine, ibus_text_new_from_string(str), len);
   }
 }
 
@@ -624,16 +1029,13 @@ static void commit_full(DkstEngine *engine) {
   // Current composed
   uint32_t syl = dkst_hangul_current_syllable(&engine->hangul);
 
-  // Any pending commit
-  char *pending = dkst_hangul_get_commit_string(&engine->hangul);
-
-  GString *full = g_string_new("");
-  if (pending) {
-    g_string_append(full, pending);
-    g_free(pending);
-  }
+  // The preedit word, any pending commit and the composed syllable
+  gsize len = word_to_commit_utf8(engine, 0);
+  engine->word_len = 0;
+  len += dkst_hangul_take_commit(&engine->hangul, engine->commit_utf8 + len,
+                                 sizeof(engine->commit_utf8) - len);
   if (syl) {
-    g_string_append_unichar(full, syl);
+    len += g_unichar_to_utf8(syl, engine->commit_utf8 + len);
   }
 
   // Use PREEDIT_COMMIT mode to commit text at the PREEDIT position (original
@@ -642,79 +1044,69 @@ static void commit_full(DkstEngine *engine) {
   // Use ibus_engine_commit_text for explicit commits (Space, Enter, etc.)
   // PREEDIT_COMMIT mode in update_preedit handles the focus_out case
   // automatically.
-  if (full->len > 0) {
-    IBusText *text = ibus_text_new_from_string(full->str);
-    ibus_engine_commit_text((IBusEngine *)engine, text);
-    // Note: commit_text takes ownership of text or refcounts?
-    // Usually we unref if we created it? IBus docs say: "text: An IBusText to
-    // be committed." Most examples show just passing it. IBus bindings usually
-    // handle ref/sink. Actually ibus_engine_commit_text usually consumes the
-    // text object float ref. But checking ibus-hangul: text = ...;
-    // ibus_engine_commit_text(...); It does not free 'text' manually if IBus
-    // takes it. g_object_ref_sink logic usually applies.
-
-    // Accumulate committed Hangul into word_buffer for multi-char hanja lookup
-    if (engine->word_buffer == NULL) {
-      engine->word_buffer = g_strdup(full->str);
-    } else {
-      gchar *new_buffer = g_strconcat(engine->word_buffer, full->str, NULL);
-      g_free(engine->word_buffer);
-      engine->word_buffer = new_buffer;
-    }
-    // Limit word_buffer size to prevent unbounded growth (max ~20 chars)
-    if (engine->word_buffer && g_utf8_strlen(engine->word_buffer, -1) > 20) {
-      g_free(engine->word_buffer);
-      engine->word_buffer = NULL;
-    }
-  }
+  commit_buffered(engine, len);
+
+  // Every caller commits because the word ended (space, punctuation, a
+  // toggle, a shortcut...), so there is nothing to convert it with later
+  history_mark_boundary(engine);
 
   // Reset internal state
   dkst_hangul_reset(&engine->hangul);
   // Ensure visual preedit is cleared/updated to match empty state
   update_preedit(engine);
+}
 
-  debug_log("commit_full: Committed '%s', word_buffer='%s'.\n", full->str,
-            engine->word_buffer ? engine->word_buffer : "");
-
-  g_string_free(full, TRUE);
+// Hangul continues a word: syllables, and jamo committed on their own
+static gboolean is_word_char(uint32_t c) {
+  return (c >= 0xAC00 && c <= 0xD7A3) || (c >= 0x3131 && c <= 0x318E);
 }
 
+// Handle what the automaton finished. Hangul is committed (and remembered
+// for multi-char hanja lookup), or in word preedit mode moved to the
+// preedit word. Anything else, like the symbols of the 3-set layouts, ends
+// the word: it is committed right after the word before it.
 static void check_and_commit_pending(DkstEngine *engine) {
-  char *pending = dkst_hangul_get_commit_string(&engine->hangul);
-  if (pending) {
-    commit_string(engine, pending);
-
-    // Also accumulate to word_buffer for multi-char hanja lookup
-    if (engine->word_buffer == NULL) {
-      engine->word_buffer = g_strdup(pending);
+  gboolean word_preedit = engine->config->word_preedit;
+  gsize len = 0;
+
+  for (size_t i = 0; i < engine->hangul.commit_len; i++) {
+    uint32_t c = engine->hangul.commit[i];
+    if (!is_word_char(c)) {
+      len = word_to_commit_utf8(engine, len);
+      engine->word_len = 0;
+      len += g_unichar_to_utf8(c, engine->commit_utf8 + len);
+      history_mark_boundary(engine);
+    } else if (!word_preedit) {
+      len += g_unichar_to_utf8(c, engine->commit_utf8 + len);
+      history_append(engine, c);
     } else {
-      gchar *new_buffer = g_strconcat(engine->word_buffer, pending, NULL);
-      g_free(engine->word_buffer);
-      engine->word_buffer = new_buffer;
-    }
-    // Limit word_buffer size
-    if (engine->word_buffer && g_utf8_strlen(engine->word_buffer, -1) > 20) {
-      g_free(engine->word_buffer);
-      engine->word_buffer = NULL;
+      if (engine->word_len == WORD_PREEDIT_MAX) {
+        // Too long to be a word; commit what there is and start over
+        len = word_to_commit_utf8(engine, len);
+        for (guint j = 0; j < engine->word_len; j++)
+          history_append(engine, engine->word[j]);
+        engine->word_len = 0;
+      }
+      engine->word[engine->word_len++] = c;
     }
-
-    g_free(pending);
   }
+  engine->hangul.commit_len = 0;
+
+  commit_buffered(engine, len);
 }
 
 // --- Properties & Setup ---
 static void dkst_engine_register_props(DkstEngine *engine) {
   // Update the InputMode property to reflect current state before registering
-  update_language_property(engine);
+  set_language_property(engine);
 
   // Register the persistent prop_list (created in init)
+  dkst_stats.property_updates++;
   ibus_engine_register_properties((IBusEngine *)engine, engine->prop_list);
 }
 
 static void dkst_engine_property_activate(IBusEngine *e, const gchar *prop_name,
                                           guint prop_state) {
-  debug_log("Property Activate: %s\n", prop_name);
-
   if (g_strcmp0(prop_name, "Setup") == 0) {
     // Launch setup.py
     gchar *argv[] = {"/usr/share/ibus-dkst/setup.py", NULL};
@@ -722,7 +1114,7 @@ static void dkst_engine_property_activate(IBusEngine *e, const gchar *prop_name,
     g_spawn_async(NULL, argv, NULL, G_SPAWN_SEARCH_PATH, NULL, NULL, NULL,
                   &error);
     if (error) {
-      debug_log("Failed to launch setup: %s\n", error->message);
+      dkst_trace(DKST_TRACE_SPAWN_FAILED, 0, error->code, 0);
       g_error_free(error);
     }
   } else if (g_strcmp0(prop_name, "HanjaEditor") == 0) {
@@ -732,7 +1124,7 @@ static void dkst_engine_property_activate(IBusEngine *e, const gchar *prop_name,
     g_spawn_async(NULL, argv, NULL, G_SPAWN_SEARCH_PATH, NULL, NULL, NULL,
                   &error);
     if (error) {
-      debug_log("Failed to launch hanja editor: %s\n", error->message);
+      dkst_trace(DKST_TRACE_SPAWN_FAILED, 1, error->code, 0);
       g_error_free(error);
     }
   } else if (g_strcmp0(prop_name, "InputMode") == 0) {
@@ -742,63 +1134,54 @@ static void dkst_engine_property_activate(IBusEngine *e, const gchar *prop_name,
   }
 }
 
-static gboolean dkst_engine_process_key_event(IBusEngine *e, guint keyval,
-                                              guint keycode, guint state) {
+static gboolean process_key(IBusEngine *e, guint keyval, guint keycode,
+                            guint state) {
   DkstEngine *engine = (DkstEngine *)e;
 
-  debug_log("Key: val=%x code=%x state=%x mode=%d hanja=%d\n", keyval, keycode,
-            state, engine->is_hangul_mode, engine->hanja_mode);
-
   // Ignore updates on release
   if (state & IBUS_RELEASE_MASK)
     return FALSE;
 
+  dkst_trace(DKST_TRACE_KEY, keyval, state,
+             engine->is_hangul_mode | engine->hanja_mode << 1);
+
+  // Drop the "dictionary loading" notice on the next key press
+  if (engine->hanja_loading_shown) {
+    engine->hanja_loading_shown = FALSE;
+    ibus_engine_hide_auxiliary_text(e);
+  }
+
+  const DkstKeyAction *action =
+      dkst_config_lookup_key(engine->config, keyval, state);
+
+  // English mode with nothing on screen: only configured keys matter
+  if (!action && !engine->is_hangul_mode && !engine->hanja_mode &&
+      !engine->showing_indicator)
+    return FALSE;
+
   // --- Hanja Mode Key Handling ---
   if (engine->hanja_mode) {
-    debug_log("Hanja mode: handling key %x\n", keyval);
-
     // Safety check
     if (!engine->table || !IBUS_IS_LOOKUP_TABLE(engine->table)) {
-      debug_log("ERROR: engine->table is invalid! ptr=%p\n",
-                (void *)engine->table);
+      dkst_trace(DKST_TRACE_HANJA_TABLE_LOST, keyval, 0, 0);
       engine->hanja_mode = FALSE;
       return FALSE;
     }
 
     // Handle candidate selection when in hanja mode
-    debug_log("Hanja mode: calling get_cursor_pos...\n");
-    guint cursor = ibus_lookup_table_get_cursor_pos(engine->table);
-    debug_log("Hanja mode: cursor=%u\n", cursor);
-
     switch (keyval) {
     case IBUS_KEY_Up:
     case IBUS_KEY_KP_Up:
-      debug_log("Hanja: cursor up\n");
-      ibus_lookup_table_cursor_up(engine->table);
-      ibus_engine_update_lookup_table(e, engine->table, TRUE);
-      return TRUE;
-
     case IBUS_KEY_Down:
     case IBUS_KEY_KP_Down:
-      debug_log("Hanja: cursor down\n");
-      ibus_lookup_table_cursor_down(engine->table);
-      ibus_engine_update_lookup_table(e, engine->table, TRUE);
-      return TRUE;
-
     case IBUS_KEY_Page_Up:
-      ibus_lookup_table_page_up(engine->table);
-      ibus_engine_update_lookup_table(e, engine->table, TRUE);
-      return TRUE;
-
     case IBUS_KEY_Page_Down:
-      ibus_lookup_table_page_down(engine->table);
-      ibus_engine_update_lookup_table(e, engine->table, TRUE);
+      move_hanja_cursor(engine, keyval);
       return TRUE;
 
     case IBUS_KEY_Return:
     case IBUS_KEY_KP_Enter:
-      cursor = ibus_lookup_table_get_cursor_pos(engine->table);
-      select_hanja_candidate(engine, cursor);
+      select_hanja_candidate(engine, engine->hanja_cursor);
       return TRUE;
 
     case IBUS_KEY_Escape:
@@ -815,12 +1198,8 @@ static gboolean dkst_engine_process_key_event(IBusEngine *e, guint keyval,
     case IBUS_KEY_7:
     case IBUS_KEY_8:
     case IBUS_KEY_9: {
-      guint page_size = ibus_lookup_table_get_page_size(engine->table);
-      guint page_start =
-          (ibus_lookup_table_get_cursor_pos(engine->table) / page_size) *
-          page_size;
-      guint index = page_start + (keyval - IBUS_KEY_1);
-      if (index < engine->hanja_candidates->len) {
+      guint index = engine->hanja_page_start + (keyval - IBUS_KEY_1);
+      if (index < engine->n_hanja_candidates) {
         select_hanja_candidate(engine, index);
       }
     }
@@ -835,49 +1214,25 @@ static gboolean dkst_engine_process_key_event(IBusEngine *e, guint keyval,
   }
 
   // --- Hanja Trigger Keys (from config) ---
-  if (engine->hanja_keys) {
-    guint mask = IBUS_SHIFT_MASK | IBUS_CONTROL_MASK | IBUS_MOD1_MASK |
-                 IBUS_SUPER_MASK | IBUS_META_MASK;
-    guint current_mods = state & mask;
-
-    GList *l;
-    for (l = engine->hanja_keys; l != NULL; l = l->next) {
-      ToggleKey *hk = (ToggleKey *)l->data;
-      if (keyval == hk->keyval && current_mods == hk->modifiers) {
-        // Allow hanja conversion if there's composed text OR word_buffer
-        if (dkst_hangul_has_composed(&engine->hangul) ||
-            (engine->word_buffer && strlen(engine->word_buffer) > 0)) {
-          show_hanja_candidates(engine);
-          return TRUE;
-        }
-        return FALSE;
-      }
+  if (action && action->type == DKST_KEY_HANJA) {
+    // Allow hanja conversion if there's composed text OR a word in history
+    // the client lets us replace
+    if (dkst_hangul_has_composed(&engine->hangul) || engine->word_len > 0 ||
+        (can_replace_committed(engine) &&
+         history_at(engine, 0) != HISTORY_BOUNDARY)) {
+      show_hanja_candidates(engine);
+      return TRUE;
     }
+    return FALSE;
   }
 
-  // Check against toggle keys
-  // For each registered toggle key, check if keyval and modifiers (excluding
-  // Locks) match Relevant modifiers for comparison: Shift, Control, Alt, Super,
-  // Meta
-  guint mask = IBUS_SHIFT_MASK | IBUS_CONTROL_MASK | IBUS_MOD1_MASK |
-               IBUS_SUPER_MASK | IBUS_META_MASK;
-  guint current_mods = state & mask;
-
-  if (engine->toggle_keys) {
-    GList *l;
-    for (l = engine->toggle_keys; l != NULL; l = l->next) {
-      ToggleKey *tk = (ToggleKey *)l->data;
-
-      if (keyval == tk->keyval && current_mods == tk->modifiers) {
-        if (keyval == tk->keyval && current_mods == tk->modifiers) {
-          debug_log("Toggle Key Matched! Toggling mode.\n");
-          commit_full(engine);
-          engine->is_hangul_mode = !engine->is_hangul_mode;
-          show_indicator(engine);
-          return TRUE;
-        }
-      }
-    }
+  // Toggle keys (from config)
+  if (action && action->type == DKST_KEY_TOGGLE) {
+    commit_full(engine);
+    engine->is_hangul_mode = !engine->is_hangul_mode;
+    dkst_trace(DKST_TRACE_MODE_TOGGLE, engine->is_hangul_mode, 0, 0);
+    show_indicator(engine);
+    return TRUE;
   }
 
   // Check for Modifier Keys themselves being pressed (not just holding
@@ -898,27 +1253,20 @@ static gboolean dkst_engine_process_key_event(IBusEngine *e, guint keyval,
   }
 
   // Custom Shift Handling
-  gboolean is_shift = (state & IBUS_SHIFT_MASK) != 0;
-  if (engine->enable_custom_shift && is_shift && engine->is_hangul_mode) {
-    const gchar *key_name = ibus_keyval_name(keyval);
-    if (key_name) {
-      gchar *mapped = g_hash_table_lookup(engine->shift_mappings, key_name);
-      if (mapped) {
-        clear_indicator(engine); // Clear if typing
-        commit_full(engine);
-        commit_string(engine, mapped);
-        return TRUE;
-      }
-    }
+  if (action && action->type == DKST_KEY_SHIFT_TEXT && engine->is_hangul_mode) {
+    clear_indicator(engine); // Clear if typing
+    commit_full(engine);
+    commit_string(engine, action->text);
+    return TRUE;
   }
 
   // Allow only Shift to pass through for typing (e.g. upper case)
   // But if Ctrl/Alt/Super are pressed, ignore.
   if (state & (IBUS_CONTROL_MASK | IBUS_MOD1_MASK | IBUS_SUPER_MASK)) {
-    debug_log("Modifier pressed, ignoring.\n");
-    if (dkst_hangul_has_composed(&engine->hangul)) {
+    if (dkst_hangul_has_composed(&engine->hangul) || engine->word_len > 0) {
       commit_full(engine);
     }
+    history_mark_boundary(engine);
     return FALSE;
   }
 
@@ -926,7 +1274,6 @@ static gboolean dkst_engine_process_key_event(IBusEngine *e, guint keyval,
   if (!engine->is_hangul_mode) {
     if (engine->showing_indicator)
       clear_indicator(engine);
-    // debug_log("English Mode. Pass.\n");
     return FALSE;
   }
 
@@ -941,9 +1288,19 @@ static gboolean dkst_engine_process_key_event(IBusEngine *e, guint keyval,
       clear_indicator(engine);
 
     if (dkst_hangul_backspace(&engine->hangul)) {
+      engine->key_class = DKST_LATENCY_COMPOSE;
+      update_preedit(engine);
+      return TRUE;
+    }
+    // Then the preedit word, a syllable at a time
+    if (engine->word_len > 0) {
+      engine->word_len--;
+      engine->key_class = DKST_LATENCY_COMPOSE;
       update_preedit(engine);
       return TRUE;
     }
+    // The application deletes committed text itself
+    history_drop_last(engine);
     return FALSE;
   }
 
@@ -951,14 +1308,7 @@ static gboolean dkst_engine_process_key_event(IBusEngine *e, guint keyval,
   if (keyval == IBUS_KEY_space || keyval == IBUS_KEY_Return) {
     if (engine->showing_indicator)
       clear_indicator(engine);
-    commit_full(engine); // Commit everything
-
-    // Reset word buffer on space/enter (word boundary)
-    if (engine->word_buffer) {
-      g_free(engine->word_buffer);
-      engine->word_buffer = NULL;
-    }
-
+    commit_full(engine); // Commit everything (a word boundary)
     return FALSE; // Let system handle space
   }
 
@@ -968,59 +1318,78 @@ static gboolean dkst_engine_process_key_event(IBusEngine *e, guint keyval,
       clear_indicator(engine);
     char c = (char)keyval;
     if (dkst_hangul_process(&engine->hangul, c)) {
+      engine->key_class = DKST_LATENCY_COMPOSE;
       check_and_commit_pending(engine);
       update_preedit(engine);
       return TRUE;
     } else {
       check_and_commit_pending(engine);
       update_preedit(engine);
-      if (dkst_hangul_has_composed(&engine->hangul)) {
+      if (dkst_hangul_has_composed(&engine->hangul) || engine->word_len > 0) {
         commit_full(engine);
       }
+      // Punctuation and digits end the word
+      history_mark_boundary(engine);
       return FALSE;
     }
   }
 
-  // Other keys
-  if (dkst_hangul_has_composed(&engine->hangul)) {
+  // Other keys (cursor movement etc.) end the word
+  if (dkst_hangul_has_composed(&engine->hangul) || engine->word_len > 0) {
     commit_full(engine);
     return FALSE;
   }
+  history_mark_boundary(engine);
 
   return FALSE;
 }
 
+// Time every key press under what it turned out to do (see latency.h)
+static gboolean dkst_engine_process_key_event(IBusEngine *e, guint keyval,
+                                              guint keycode, guint state) {
+  DkstEngine *engine = (DkstEngine *)e;
+
+  if (state & IBUS_RELEASE_MASK)
+    return process_key(e, keyval, keycode, state);
+  dkst_stats.keys++;
+
+  gint64 start = dkst_latency_now();
+  engine->key_class = DKST_LATENCY_OTHER;
+  gboolean handled = process_key(e, keyval, keycode, state);
+  dkst_latency_record(engine->key_class, dkst_latency_now() - start);
+  return handled;
+}
+
 static void dkst_engine_focus_in(IBusEngine *e) {
   DkstEngine *engine = (DkstEngine *)e;
-  debug_log("Focus In\n");
+  dkst_trace(DKST_TRACE_FOCUS_IN,
+             dkst_hangul_current_syllable(&engine->hangul), 0, 0);
 
   // Safety: Ensure no leftover state from previous interactions
-  if (dkst_hangul_has_composed(&engine->hangul)) {
-    debug_log("Focus In: Cleansing leftover state. (Cho=%x Jung=%x Jong=%x)\n",
-              engine->hangul.cho, engine->hangul.jung, engine->hangul.jong);
+  if (dkst_hangul_has_composed(&engine->hangul) || engine->word_len > 0) {
     dkst_hangul_reset(&engine->hangul);
     dkst_hangul_reset(&engine->hangul);
-    ibus_engine_hide_preedit_text(e);
+    engine->word_len = 0;
+    hide_preedit(engine);
   }
 
   // Also clear indicator on focus in, just in case
   clear_indicator(engine);
+  // Text committed elsewhere cannot be converted here
+  history_mark_boundary(engine);
 
-  // Refresh config on focus in
-  load_config(engine);
-  // Register Properties
+  // Pick up settings changed since the last focus-in
+  apply_config(engine);
+  // Register Properties (in their current state, so no update follows)
   dkst_engine_register_props(engine);
-  update_language_property(engine);
 }
 
 static void dkst_engine_focus_out(IBusEngine *e) {
   DkstEngine *engine = (DkstEngine *)e;
-  debug_log("Focus Out: Starting... (Hangul Mode: %d)\n",
-            engine->is_hangul_mode);
+  dkst_trace(DKST_TRACE_FOCUS_OUT,
+             dkst_hangul_current_syllable(&engine->hangul), 0, 0);
 
   if (dkst_hangul_has_composed(&engine->hangul)) {
-    debug_log("Focus Out: Has composed text. Resetting internal state "
-              "(auto-commit expected).\n");
     // Do NOT commit manually here. ibus_engine_update_preedit_text_with_mode
     // (used in update_preedit) handles the commit at the correct position
     // automatically.
@@ -1028,38 +1397,36 @@ static void dkst_engine_focus_out(IBusEngine *e) {
     // Clearing the preedit buffer logic:
     // ibus-hangul does: hangul_ic_reset + ustring_clear
     // We just reset our hangul state.
-  } else {
-    debug_log("Focus Out: No composed text.\n");
   }
+  // The preedit word goes to the client the same way
+  engine->word_len = 0;
+  engine->preedit_state = PREEDIT_UNKNOWN;
 
   // Clear indicator on focus out
   clear_indicator(engine);
-  debug_log("Focus Out: Finished.\n");
 }
 
 static void dkst_engine_reset(IBusEngine *e) {
   DkstEngine *engine = (DkstEngine *)e;
-  debug_log("Reset: Starting...\n");
+  dkst_trace(DKST_TRACE_RESET, dkst_hangul_current_syllable(&engine->hangul), 0,
+             0);
   // Similarly, reset signal should rely on PREEDIT_COMMIT auto-behavior
   dkst_hangul_reset(&engine->hangul);
-  debug_log("Reset: Finished.\n");
+  engine->word_len = 0;
+  engine->preedit_state = PREEDIT_UNKNOWN;
+  // Clients reset when the cursor moves away from what was typed
+  history_mark_boundary(engine);
 }
 
 static void dkst_engine_disable(IBusEngine *e) {
   DkstEngine *engine = (DkstEngine *)e;
-  debug_log("Disable\n");
+  dkst_trace(DKST_TRACE_DISABLE, 0, 0, 0);
   commit_full(engine);
 }
 
 static void dkst_engine_set_capabilities(IBusEngine *e, guint caps) {
-  // Log the capabilities reported by the client application
-  debug_log("set_capabilities: %x\n", caps);
-
-  if (caps & IBUS_CAP_PREEDIT_TEXT) {
-    debug_log("Client supports IBUS_CAP_PREEDIT_TEXT\n");
-  } else {
-    debug_log("Client DOES NOT support IBUS_CAP_PREEDIT_TEXT\n");
-  }
+  // Record the capabilities reported by the client application
+  dkst_trace(DKST_TRACE_CAPABILITIES, caps, 0, 0);
 }
 
 static void dkst_engine_class_init(DkstEngineClass *klass) {
@@ -1080,7 +1447,9 @@ static void dkst_engine_class_init(DkstEngineClass *klass) {
 }
 
 // --- Main ---
+// The headless harness (bench_engine.c) creates engines itself
 
+#ifndef DKST_HEADLESS
 static IBusBus *bus = NULL;
 static IBusFactory *factory = NULL;
 
@@ -1088,6 +1457,34 @@ static void ibus_disconnected_cb(IBusBus *bus, gpointer user_data) {
   ibus_quit();
 }
 
+// Write a diagnostic report to ~/.cache/ibus-dkst/name
+static void dump_to_cache(const char *name,
+                          gboolean (*dump)(const char *path, GError **error)) {
+  gchar *dir = g_build_filename(g_get_user_cache_dir(), "ibus-dkst", NULL);
+  gchar *path = g_build_filename(dir, name, NULL);
+  GError *error = NULL;
+
+  g_mkdir_with_parents(dir, 0700);
+  if (!dump(path, &error)) {
+    g_warning("Cannot write %s: %s", path, error->message);
+    g_error_free(error);
+  }
+  g_free(path);
+  g_free(dir);
+}
+
+// kill -USR1 writes the key latency histograms
+static gboolean on_dump_latency(gpointer user_data) {
+  dump_to_cache("latency.txt", dkst_latency_dump);
+  return G_SOURCE_CONTINUE;
+}
+
+// kill -USR2 writes the trace ring
+static gboolean on_dump_trace(gpointer user_data) {
+  dump_to_cache("trace.txt", dkst_trace_dump);
+  return G_SOURCE_CONTINUE;
+}
+
 static void init(void) {
   ibus_init();
 
@@ -1101,10 +1498,43 @@ static void init(void) {
     g_warning("Failed to get name: com.dkst.inputmethod");
     exit(1);
   }
+
+  GError *error = NULL;
+  if (!dkst_stats_export(ibus_bus_get_connection(bus), &error)) {
+    g_warning("Cannot export statistics: %s", error->message);
+    g_error_free(error);
+  }
+
+  g_unix_signal_add(SIGUSR1, on_dump_latency, NULL);
+  g_unix_signal_add(SIGUSR2, on_dump_trace, NULL);
+}
+
+// dkst-ime --stats: print the counters of the running engine
+static int print_stats(void) {
+  ibus_init();
+  IBusBus *client = ibus_bus_new();
+  if (!ibus_bus_is_connected(client)) {
+    fprintf(stderr, "dkst-ime: cannot connect to IBus\n");
+    return 1;
+  }
+
+  GError *error = NULL;
+  gboolean ok = dkst_stats_print(ibus_bus_get_connection(client),
+                                 "com.dkst.inputmethod", &error);
+  if (!ok) {
+    fprintf(stderr, "dkst-ime: %s\n", error->message);
+    g_error_free(error);
+  }
+  g_object_unref(client);
+  return ok ? 0 : 1;
 }
 
 int main(int argc, char **argv) {
+  if (argc > 1 && strcmp(argv[1], "--stats") == 0)
+    return print_stats();
+
   init();
   ibus_main();
   return 0;
 }
+#endif
@@ -0,0 +1,294 @@
+#!/usr/bin/env python3
+"""Generate hangul_tables.h from the layout descriptions in layouts/.
+
+Each .layout file lists what every ASCII key types (a jamo or a literal
+symbol) and the jamo combination rules of one keyboard layout. This script
+turns them into the dense lookup tables that drive the composition
+automaton in hangul.c, so adding a layout is a data change instead of a
+code change.
+
+Usage: gen_hangul_tables.py OUTPUT LAYOUT...
+"""
+import os
+import sys
+import unicodedata
+
+CHO_BASE, N_CHO = 0x1100, 19
+JUNG_BASE, N_JUNG = 0x1161, 21
+JONG_BASE, N_JONG = 0x11A7, 28  # Index 0 means "no jongseong"
+
+KEY_NONE, KEY_CHO, KEY_JUNG, KEY_JONG, KEY_SYMBOL = 0, 1, 2, 3, 4
+
+LAYOUT_TYPES = {"2set": "DKST_LAYOUT_2SET", "3set": "DKST_LAYOUT_3SET"}
+
+
+def compat_name(jamo):
+    """'ㄱ' -> 'KIYEOK', 'ㅘ' -> 'WA'."""
+    name = unicodedata.name(jamo, "")
+    if not name.startswith("HANGUL LETTER "):
+        raise ValueError(f"not a compatibility jamo: {jamo!r}")
+    return name[len("HANGUL LETTER "):]
+
+
+def conjoining(role, jamo):
+    """Map a compatibility jamo to its CHOSEONG/JUNGSEONG/JONGSEONG form."""
+    try:
+        return ord(unicodedata.lookup(f"HANGUL {role} {compat_name(jamo)}"))
+    except KeyError:
+        return 0
+
+
+def in_range(c, base, n):
+    return base <= c < base + n
+
+
+def parse_char(field):
+    """A literal character, or U+XXXX for ones the file format reserves."""
+    if field.upper().startswith("U+") and len(field) > 2:
+        return chr(int(field[2:], 16))
+    if len(field) != 1:
+        raise ValueError(f"expected one character or U+XXXX: {field!r}")
+    return field
+
+
+class Layout:
+    def __init__(self, path):
+        self.path = path
+        self.name = os.path.splitext(os.path.basename(path))[0]
+        self.type = "2set"
+        self.key_jamo = [0] * 128
+        self.key_class = [KEY_NONE] * 128
+        self.cho_combine = {}  # (first index, second index) -> codepoint
+        self.jung_combine = {}
+        self.jong_combine = {}
+        self.cho_split = {}  # index -> (first, second) codepoints
+        self.jung_split = {}
+        self.jong_split = {}
+        self.parse()
+
+    def error(self, lineno, msg):
+        sys.exit(f"{self.path}:{lineno}: {msg}")
+
+    def parse(self):
+        with open(self.path, encoding="utf-8") as f:
+            for lineno, line in enumerate(f, 1):
+                fields = line.split("#", 1)[0].split()
+                if not fields:
+                    continue
+                try:
+                    self.parse_fields(fields)
+                except ValueError as e:
+                    self.error(lineno, e)
+
+    def parse_fields(self, fields):
+        kind, args = fields[0], fields[1:]
+        if kind == "name" and len(args) == 1:
+            self.name = args[0]
+        elif kind == "type" and len(args) == 1:
+            if args[0] not in LAYOUT_TYPES:
+                raise ValueError(f"unsupported layout type {args[0]!r}")
+            self.type = args[0]
+        elif kind == "key" and len(args) in (2, 3):
+            self.add_key(*args)
+        elif kind in ("cho", "jung", "jong") and len(args) == 3:
+            self.add_combine(kind, *args)
+        else:
+            raise ValueError(f"cannot parse {' '.join(fields)!r}")
+
+    def add_key(self, key, value, role=None):
+        """key <ascii> <jamo> [cho|jong], or key <ascii> <symbol>.
+
+        Consonants type choseong in 2-set layouts; 3-set layouts have
+        separate initial and final consonant keys, so they name the role.
+        Anything that is not a compatibility jamo is a literal symbol.
+        """
+        key = parse_char(key)
+        if not 0x20 < ord(key) < 0x7F:
+            raise ValueError(f"key must be printable ASCII: {key!r}")
+        value = parse_char(value)
+
+        if unicodedata.name(value, "").startswith("HANGUL LETTER "):
+            jung = conjoining("JUNGSEONG", value)
+            if role is None and in_range(jung, JUNG_BASE, N_JUNG):
+                jamo, cls = jung, KEY_JUNG
+            else:
+                if role is None and self.type == "3set":
+                    raise ValueError(f"3-set consonant {value!r} needs a role")
+                role = role or "cho"
+                if role == "cho":
+                    jamo, cls = conjoining("CHOSEONG", value), KEY_CHO
+                    ok = in_range(jamo, CHO_BASE, N_CHO)
+                elif role == "jong":
+                    jamo, cls = conjoining("JONGSEONG", value), KEY_JONG
+                    ok = in_range(jamo, JONG_BASE + 1, N_JONG - 1)
+                else:
+                    raise ValueError(f"unknown role {role!r}")
+                if not ok:
+                    raise ValueError(f"{value!r} is not a modern {role} jamo")
+        elif role is None:
+            jamo, cls = ord(value), KEY_SYMBOL
+            if jamo > 0xFFFF:
+                raise ValueError(f"symbol outside the BMP: {value!r}")
+        else:
+            raise ValueError(f"{value!r} is not a jamo")
+
+        self.key_jamo[ord(key)] = jamo
+        self.key_class[ord(key)] = cls
+
+    def add_combine(self, kind, first, second, result):
+        role, base, n = {
+            "cho": ("CHOSEONG", CHO_BASE, N_CHO),
+            "jung": ("JUNGSEONG", JUNG_BASE, N_JUNG),
+            "jong": ("JONGSEONG", JONG_BASE, N_JONG),
+        }[kind]
+        a, b, r = (conjoining(role, j) for j in (first, second, result))
+        if not all(in_range(c, base + (kind == "jong"), n - (kind == "jong"))
+                   for c in (a, b, r)):
+            raise ValueError(f"{first}+{second}={result} is not a {kind} rule")
+        getattr(self, f"{kind}_combine")[(a - base, b - base)] = r
+        getattr(self, f"{kind}_split")[r - base] = (a, b)
+
+
+def fmt_array(values, per_line=8, indent="      ", fmt="0x{:04X}"):
+    lines = []
+    for i in range(0, len(values), per_line):
+        chunk = values[i:i + per_line]
+        lines.append(indent + ", ".join(fmt.format(v) for v in chunk) + ",")
+    return "\n".join(lines)
+
+
+def emit_layout(out, layout):
+    out.append("    {")
+    out.append(f'     .name = "{layout.name}",')
+    out.append(f"     .type = {LAYOUT_TYPES[layout.type]},")
+    out.append("     .key_jamo = {")
+    out.append(fmt_array(layout.key_jamo))
+    out.append("     },")
+    out.append("     .key_class = {")
+    out.append(fmt_array(layout.key_class, 16, fmt="{}"))
+    out.append("     },")
+    for kind in ("cho", "jung", "jong"):
+        out.append(f"     .{kind}_combine = {{")
+        for (a, b), r in sorted(getattr(layout, f"{kind}_combine").items()):
+            out.append(f"      [{a}][{b}] = 0x{r:04X},")
+        out.append("     },")
+        out.append(f"     .{kind}_split = {{")
+        for i, (a, b) in sorted(getattr(layout, f"{kind}_split").items()):
+            out.append(f"      [{i}] = {{0x{a:04X}, 0x{b:04X}}},")
+        out.append("     },")
+    out.append("    },")
+
+
+def universal_tables():
+    """Layout-independent jamo conversions, derived from Unicode names."""
+    cho_to_jong, cho_compat = [], []
+    for i in range(N_CHO):
+        name = unicodedata.name(chr(CHO_BASE + i))[len("HANGUL CHOSEONG "):]
+        try:
+            jong = ord(unicodedata.lookup(f"HANGUL JONGSEONG {name}"))
+        except KeyError:
+            jong = 0
+        cho_to_jong.append(jong if in_range(jong, JONG_BASE + 1, N_JONG - 1)
+                           else 0)
+        cho_compat.append(ord(unicodedata.lookup(f"HANGUL LETTER {name}")))
+
+    jong_to_cho = [0] * N_JONG
+    for i, jong in enumerate(cho_to_jong):
+        if jong:
+            jong_to_cho[jong - JONG_BASE] = CHO_BASE + i
+
+    jung_compat = []
+    for i in range(N_JUNG):
+        name = unicodedata.name(chr(JUNG_BASE + i))[len("HANGUL JUNGSEONG "):]
+        jung_compat.append(ord(unicodedata.lookup(f"HANGUL LETTER {name}")))
+
+    jong_compat = [0]
+    for i in range(1, N_JONG):
+        name = unicodedata.name(chr(JONG_BASE + i))[len("HANGUL JONGSEONG "):]
+        jong_compat.append(ord(unicodedata.lookup(f"HANGUL LETTER {name}")))
+
+    return [
+        ("dkst_cho_to_jong", N_CHO, cho_to_jong),
+        ("dkst_jong_to_cho", N_JONG, jong_to_cho),
+        ("dkst_cho_compat", N_CHO, cho_compat),
+        ("dkst_jung_compat", N_JUNG, jung_compat),
+        ("dkst_jong_compat", N_JONG, jong_compat),
+    ]
+
+
+def main():
+    if len(sys.argv) < 3:
+        sys.exit("Usage: gen_hangul_tables.py OUTPUT LAYOUT...")
+    output, paths = sys.argv[1], sys.argv[2:]
+    layouts = [Layout(p) for p in paths]
+
+    out = [
+        f"// Generated by gen_hangul_tables.py from {', '.join(paths)}.",
+        "// Do not edit; change the layout files instead.",
+        "#ifndef HANGUL_TABLES_H",
+        "#define HANGUL_TABLES_H",
+        "",
+        "#include <stdint.h>",
+        "",
+        "// What an ASCII key types in a layout",
+        "typedef enum {",
+        "  DKST_KEY_NONE,   // Not a Hangul key",
+        "  DKST_KEY_CHO,    // Initial consonant (U+1100..U+1112)",
+        "  DKST_KEY_JUNG,   // Vowel (U+1161..U+1175)",
+        "  DKST_KEY_JONG,   // Final consonant (U+11A8..U+11C2), 3-set only",
+        "  DKST_KEY_SYMBOL, // Literal character committed as-is",
+        "} DKSTKeyClass;",
+        "",
+        "// Which automaton a layout uses",
+        "typedef enum {",
+        "  DKST_LAYOUT_2SET, // Consonant keys type initials; "
+        "finals are inferred",
+        "  DKST_LAYOUT_3SET, // Separate initial, vowel and final keys",
+        "} DKSTLayoutType;",
+        "",
+        "// Lookup tables of one keyboard layout. "
+        "Jamo are conjoining codepoints;",
+        "// initials are indexed from U+1100, vowels from U+1161, finals from",
+        "// U+11A7 (so index 0 is \"no jongseong\"). 0 means no entry.",
+        "typedef struct DKSTLayout {",
+        "  const char *name;",
+        "  DKSTLayoutType type;",
+        "  uint16_t key_jamo[128];        // ASCII key -> jamo or symbol",
+        "  uint8_t key_class[128];        // ASCII key -> DKSTKeyClass",
+        f"  uint16_t cho_combine[{N_CHO}][{N_CHO}];  "
+        "// Initial + initial -> double",
+        f"  uint16_t cho_split[{N_CHO}][2];     "
+        "// Double initial -> its parts",
+        f"  uint16_t jung_combine[{N_JUNG}][{N_JUNG}]; "
+        "// Vowel + vowel -> compound",
+        f"  uint16_t jung_split[{N_JUNG}][2];    "
+        "// Compound vowel -> its parts",
+        f"  uint16_t jong_combine[{N_JONG}][{N_JONG}]; "
+        "// Final + final -> compound",
+        f"  uint16_t jong_split[{N_JONG}][2];    "
+        "// Compound final -> its parts",
+        "} DKSTLayout;",
+        "",
+    ]
+
+    for name, n, values in universal_tables():
+        out.append(f"static const uint16_t {name}[{n}] = {{")
+        out.append(fmt_array(values, indent="    "))
+        out.append("};")
+        out.append("")
+
+    out.append(f"#define DKST_N_LAYOUTS {len(layouts)}")
+    out.append("")
+    out.append("static const DKSTLayout dkst_layouts[DKST_N_LAYOUTS] = {")
+    for layout in layouts:
+        emit_layout(out, layout)
+    out.append("};")
+    out.append("")
+    out.append("#endif")
+
+    with open(output, "w", encoding="utf-8") as f:
+        f.write("\n".join(out) + "\n")
+
+
+if __name__ == "__main__":
+    main()
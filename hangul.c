@@ -1,7 +1,6 @@
 
 #include "hangul.h"
-#include <stdio.h>
-#include <stdlib.h>
+#include "hangul_tables.h"
 #include <string.h>
 
 // Jamo Ranges
@@ -9,167 +8,54 @@
 #define IS_JUNG(c) (0x1161 <= (c) && (c) <= 0x1175)
 #define IS_JONG(c) (0x11A8 <= (c) && (c) <= 0x11C2)
 
-void dkst_hangul_init(DKSTHangul *h) {
+void dkst_hangul_init(DKSTHangul *h, uint32_t *commit_buf,
+                      size_t commit_size) {
   h->cho = 0;
   h->jung = 0;
   h->jong = 0;
-  h->buffer = g_string_new("");
-  h->completed = g_string_new("");
+  h->commit = commit_buf;
+  h->commit_len = 0;
+  h->commit_size = commit_size;
   h->moa_jjiki_enabled = true;
   h->backspace_mode = DKST_BACKSPACE_JASO;
+  h->layout = &dkst_layouts[0];
 }
 
 void dkst_hangul_reset(DKSTHangul *h) {
   h->cho = 0;
   h->jung = 0;
   h->jong = 0;
-  // buffer usually tracks raw input history, but logic here is state-based.
-  // We clear it for consistency.
-  g_string_truncate(h->buffer, 0);
-  // Do NOT clear completed here automatically? logic says commit consumes it.
+  // Pending commits are not cleared: taking them consumes them.
 }
 
-void dkst_hangul_free(DKSTHangul *h) {
-  if (h->buffer)
-    g_string_free(h->buffer, TRUE);
-  if (h->completed)
-    g_string_free(h->completed, TRUE);
+bool dkst_hangul_set_layout(DKSTHangul *h, const char *name) {
+  for (int i = 0; i < DKST_N_LAYOUTS; i++) {
+    if (name && strcmp(dkst_layouts[i].name, name) == 0) {
+      dkst_hangul_reset(h);
+      h->layout = &dkst_layouts[i];
+      return true;
+    }
+  }
+  return false;
 }
 
-// Map char to Jamo
-static uint32_t map_key(char c) {
-  switch (c) {
-  case 'q':
-    return 0x1107;
-  case 'Q':
-    return 0x1108; // ㅂ, ㅃ
-  case 'w':
-    return 0x110c;
-  case 'W':
-    return 0x110d; // ㅈ, ㅉ
-  case 'e':
-    return 0x1103;
-  case 'E':
-    return 0x1104; // ㄷ, ㄸ
-  case 'r':
-    return 0x1100;
-  case 'R':
-    return 0x1101; // ㄱ, ㄲ
-  case 't':
-    return 0x1109;
-  case 'T':
-    return 0x110a; // ㅅ, ㅆ
-  case 'y':
-    return 0x116d;
-  case 'Y':
-    return 0x116d; // ㅛ
-  case 'u':
-    return 0x1167;
-  case 'U':
-    return 0x1167; // ㅕ
-  case 'i':
-    return 0x1163;
-  case 'I':
-    return 0x1163; // ㅑ
-  case 'o':
-    return 0x1162;
-  case 'O':
-    return 0x1164; // ㅐ, ㅒ
-  case 'p':
-    return 0x1166;
-  case 'P':
-    return 0x1168; // ㅔ, ㅖ
-
-  case 'a':
-    return 0x1106;
-  case 'A':
-    return 0x1106; // ㅁ
-  case 's':
-    return 0x1102;
-  case 'S':
-    return 0x1102; // ㄴ
-  case 'd':
-    return 0x110b;
-  case 'D':
-    return 0x110b; // ㅇ
-  case 'f':
-    return 0x1105;
-  case 'F':
-    return 0x1105; // ㄹ
-  case 'g':
-    return 0x1112;
-  case 'G':
-    return 0x1112; // ㅎ
-  case 'h':
-    return 0x1169;
-  case 'H':
-    return 0x1169; // ㅗ
-  case 'j':
-    return 0x1165;
-  case 'J':
-    return 0x1165; // ㅓ
-  case 'k':
-    return 0x1161;
-  case 'K':
-    return 0x1161; // ㅏ
-  case 'l':
-    return 0x1175;
-  case 'L':
-    return 0x1175; // ㅣ
-
-  case 'z':
-    return 0x110f;
-  case 'Z':
-    return 0x110f; // ㅋ
-  case 'x':
-    return 0x1110;
-  case 'X':
-    return 0x1110; // ㅌ
-  case 'c':
-    return 0x110e;
-  case 'C':
-    return 0x110e; // ㅊ
-  case 'v':
-    return 0x1111;
-  case 'V':
-    return 0x1111; // ㅍ
-  case 'b':
-    return 0x1172;
-  case 'B':
-    return 0x1172; // ㅠ
-  case 'n':
-    return 0x116e;
-  case 'N':
-    return 0x116e; // ㅜ
-  case 'm':
-    return 0x1173;
-  case 'M':
-    return 0x1173; // ㅡ
-  default:
-    return 0;
-  }
+// Map char to Jamo (or symbol, for DKST_KEY_SYMBOL keys)
+static uint32_t map_key(const DKSTLayout *layout, char c) {
+  return (unsigned char)c < 128 ? layout->key_jamo[(unsigned char)c] : 0;
+}
+
+static DKSTKeyClass key_class(const DKSTLayout *layout, char c) {
+  return (unsigned char)c < 128 ? layout->key_class[(unsigned char)c]
+                                : DKST_KEY_NONE;
 }
 
 static uint32_t compatibility_jamo(uint32_t u) {
-  if (0x1100 <= u && u <= 0x1112) {
-    // Simple offset mapping for Chosung to Compatibility Jamo
-    static const uint32_t map[] = {0x3131, 0x3132, 0x3134, 0x3137, 0x3138,
-                                   0x3139, 0x3141, 0x3142, 0x3143, 0x3145,
-                                   0x3146, 0x3147, 0x3148, 0x3149, 0x314A,
-                                   0x314B, 0x314C, 0x314D, 0x314E};
-    int idx = u - 0x1100;
-    if (idx >= 0 && idx < 19)
-      return map[idx];
-  }
-  if (0x1161 <= u && u <= 0x1175) {
-    static const uint32_t map[] = {
-        0x314F, 0x3150, 0x3151, 0x3152, 0x3153, 0x3154, 0x3155,
-        0x3156, 0x3157, 0x3158, 0x3159, 0x315A, 0x315B, 0x315C,
-        0x315D, 0x315E, 0x315F, 0x3160, 0x3161, 0x3162, 0x3163};
-    int idx = u - 0x1161;
-    if (idx >= 0 && idx < 21)
-      return map[idx];
-  }
+  if (IS_CHO(u))
+    return dkst_cho_compat[u - 0x1100];
+  if (IS_JUNG(u))
+    return dkst_jung_compat[u - 0x1161];
+  if (IS_JONG(u))
+    return dkst_jong_compat[u - 0x11A7];
   return u;
 }
 
@@ -190,194 +76,67 @@ static int jong_index(uint32_t c) {
 }
 
 static uint32_t cho_to_jong(uint32_t c) {
-  // Mapping table from py
-  switch (c) {
-  case 0x1100:
-    return 0x11A8;
-  case 0x1101:
-    return 0x11A9;
-  case 0x1102:
-    return 0x11AB;
-  case 0x1103:
-    return 0x11AE;
-  case 0x1105:
-    return 0x11AF;
-  case 0x1106:
-    return 0x11B7;
-  case 0x1107:
-    return 0x11B8;
-  case 0x1109:
-    return 0x11BA;
-  case 0x110A:
-    return 0x11BB;
-  case 0x110B:
-    return 0x11BC;
-  case 0x110C:
-    return 0x11BD;
-  case 0x110E:
-    return 0x11BE;
-  case 0x110F:
-    return 0x11BF;
-  case 0x1110:
-    return 0x11C0;
-  case 0x1111:
-    return 0x11C1;
-  case 0x1112:
-    return 0x11C2;
-  default:
-    return 0;
-  }
+  return IS_CHO(c) ? dkst_cho_to_jong[c - 0x1100] : 0;
 }
 static uint32_t jong_to_cho(uint32_t c) {
-  switch (c) {
-  case 0x11A8:
-    return 0x1100;
-  case 0x11A9:
-    return 0x1101;
-  case 0x11AB:
-    return 0x1102;
-  case 0x11AE:
-    return 0x1103;
-  case 0x11AF:
-    return 0x1105;
-  case 0x11B7:
-    return 0x1106;
-  case 0x11B8:
-    return 0x1107;
-  case 0x11BA:
-    return 0x1109;
-  case 0x11BB:
-    return 0x110A;
-  case 0x11BC:
-    return 0x110B;
-  case 0x11BD:
-    return 0x110C;
-  case 0x11BE:
-    return 0x110E;
-  case 0x11BF:
-    return 0x110F;
-  case 0x11C0:
-    return 0x1110;
-  case 0x11C1:
-    return 0x1111;
-  case 0x11C2:
-    return 0x1112;
-  default:
+  return dkst_jong_to_cho[jong_index(c)];
+}
+
+static uint32_t combine_cho(const DKSTLayout *layout, uint32_t a, uint32_t b) {
+  if (!IS_CHO(a) || !IS_CHO(b))
     return 0;
+  return layout->cho_combine[a - 0x1100][b - 0x1100];
+}
+
+static void split_cho(const DKSTLayout *layout, uint32_t c, uint32_t *j1,
+                      uint32_t *j2) {
+  const uint16_t *parts = IS_CHO(c) ? layout->cho_split[c - 0x1100] : NULL;
+  if (parts && parts[1]) {
+    *j1 = parts[0];
+    *j2 = parts[1];
+  } else {
+    *j1 = c;
+    *j2 = 0;
   }
 }
 
-static uint32_t combine_jung(uint32_t a, uint32_t b) {
-  if (a == 0x1169 && b == 0x1161)
-    return 0x116A; // ㅘ
-  if (a == 0x1169 && b == 0x1162)
-    return 0x116B; // ㅙ
-  if (a == 0x1169 && b == 0x1175)
-    return 0x116C; // ㅚ
-  if (a == 0x116e && b == 0x1165)
-    return 0x116F; // ㅝ
-  if (a == 0x116e && b == 0x1166)
-    return 0x1170; // ㅞ
-  if (a == 0x116e && b == 0x1175)
-    return 0x1171; // ㅟ
-  if (a == 0x1173 && b == 0x1175)
-    return 0x1174; // ㅢ
-  return 0;
+static uint32_t combine_jung(const DKSTLayout *layout, uint32_t a,
+                             uint32_t b) {
+  if (!IS_JUNG(a) || !IS_JUNG(b))
+    return 0;
+  return layout->jung_combine[a - 0x1161][b - 0x1161];
 }
 
-static void split_jung(uint32_t c, uint32_t *j1, uint32_t *j2) {
-  *j1 = c;
-  *j2 = 0;
-  if (c == 0x116A) {
-    *j1 = 0x1169;
-    *j2 = 0x1161;
-  } else if (c == 0x116B) {
-    *j1 = 0x1169;
-    *j2 = 0x1162;
-  } else if (c == 0x116C) {
-    *j1 = 0x1169;
-    *j2 = 0x1175;
-  } else if (c == 0x116F) {
-    *j1 = 0x116e;
-    *j2 = 0x1165;
-  } else if (c == 0x1170) {
-    *j1 = 0x116e;
-    *j2 = 0x1166;
-  } else if (c == 0x1171) {
-    *j1 = 0x116e;
-    *j2 = 0x1175;
-  } else if (c == 0x1174) {
-    *j1 = 0x1173;
-    *j2 = 0x1175;
+static void split_jung(const DKSTLayout *layout, uint32_t c, uint32_t *j1,
+                       uint32_t *j2) {
+  const uint16_t *parts = IS_JUNG(c) ? layout->jung_split[c - 0x1161] : NULL;
+  if (parts && parts[1]) {
+    *j1 = parts[0];
+    *j2 = parts[1];
+  } else {
+    *j1 = c;
+    *j2 = 0;
   }
 }
 
-static uint32_t combine_jong(uint32_t a, uint32_t b) {
-  if (a == 0x11A8 && b == 0x11BA)
-    return 0x11AA; // ㄳ
-  if (a == 0x11AB && b == 0x11BD)
-    return 0x11AC; // ㄵ
-  if (a == 0x11AB && b == 0x11C2)
-    return 0x11AD; // ㄶ
-  if (a == 0x11AF && b == 0x11A8)
-    return 0x11B0; // ㄺ
-  if (a == 0x11AF && b == 0x11B7)
-    return 0x11B1; // ㄻ
-  if (a == 0x11AF && b == 0x11B8)
-    return 0x11B2; // ㄼ
-  if (a == 0x11AF && b == 0x11BA)
-    return 0x11B3; // ㄽ
-  if (a == 0x11AF && b == 0x11C0)
-    return 0x11B4; // ㄾ
-  if (a == 0x11AF && b == 0x11C1)
-    return 0x11B5; // ㄿ
-  if (a == 0x11AF && b == 0x11C2)
-    return 0x11B6; // ㅀ
-  if (a == 0x11B8 && b == 0x11BA)
-    return 0x11B9; // ㅄ
-  return 0;
+static uint32_t combine_jong(const DKSTLayout *layout, uint32_t a,
+                             uint32_t b) {
+  return layout->jong_combine[jong_index(a)][jong_index(b)];
 }
 
-static void split_jong(uint32_t c, uint32_t *j1, uint32_t *j2) {
-  *j1 = c;
-  *j2 = 0;
-  if (c == 0x11AA) {
-    *j1 = 0x11A8;
-    *j2 = 0x11BA;
-  } else if (c == 0x11AC) {
-    *j1 = 0x11AB;
-    *j2 = 0x11BD;
-  } else if (c == 0x11AD) {
-    *j1 = 0x11AB;
-    *j2 = 0x11C2;
-  } else if (c == 0x11B0) {
-    *j1 = 0x11AF;
-    *j2 = 0x11A8;
-  } else if (c == 0x11B1) {
-    *j1 = 0x11AF;
-    *j2 = 0x11B7;
-  } else if (c == 0x11B2) {
-    *j1 = 0x11AF;
-    *j2 = 0x11B8;
-  } else if (c == 0x11B3) {
-    *j1 = 0x11AF;
-    *j2 = 0x11BA;
-  } else if (c == 0x11B4) {
-    *j1 = 0x11AF;
-    *j2 = 0x11C0;
-  } else if (c == 0x11B5) {
-    *j1 = 0x11AF;
-    *j2 = 0x11C1;
-  } else if (c == 0x11B6) {
-    *j1 = 0x11AF;
-    *j2 = 0x11C2;
-  } else if (c == 0x11B9) {
-    *j1 = 0x11B8;
-    *j2 = 0x11BA;
+static void split_jong(const DKSTLayout *layout, uint32_t c, uint32_t *j1,
+                       uint32_t *j2) {
+  const uint16_t *parts = layout->jong_split[jong_index(c)];
+  if (parts[1]) {
+    *j1 = parts[0];
+    *j2 = parts[1];
+  } else {
+    *j1 = c;
+    *j2 = 0;
   }
 }
 
-uint32_t dkst_hangul_current_syllable(DKSTHangul *h) {
+uint32_t dkst_hangul_current_syllable(const DKSTHangul *h) {
   if (h->cho == 0 && h->jung == 0 && h->jong == 0)
     return 0;
 
@@ -386,6 +145,8 @@ uint32_t dkst_hangul_current_syllable(DKSTHangul *h) {
     return compatibility_jamo(h->cho);
   if (!h->cho && h->jung && !h->jong)
     return compatibility_jamo(h->jung);
+  if (!h->cho && !h->jung && h->jong)
+    return compatibility_jamo(h->jong); // 3-set final typed on its own
 
   int c = (h->cho) ? cho_index(h->cho) : -1;
   int j = (h->jung) ? jung_index(h->jung) : -1;
@@ -417,7 +178,7 @@ bool dkst_hangul_backspace(DKSTHangul *h) {
   // Jaso Mode: Detailed breakdown
   if (h->jong != 0) {
     uint32_t j1, j2;
-    split_jong(h->jong, &j1, &j2);
+    split_jong(h->layout, h->jong, &j1, &j2);
     if (j2)
       h->jong = j1;
     else
@@ -427,7 +188,7 @@ bool dkst_hangul_backspace(DKSTHangul *h) {
 
   if (h->jung != 0) {
     uint32_t j1, j2;
-    split_jung(h->jung, &j1, &j2);
+    split_jung(h->layout, h->jung, &j1, &j2);
     if (j2)
       h->jung = j1;
     else
@@ -436,130 +197,337 @@ bool dkst_hangul_backspace(DKSTHangul *h) {
   }
 
   if (h->cho != 0) {
-    h->cho = 0;
+    uint32_t j1, j2;
+    split_cho(h->layout, h->cho, &j1, &j2);
+    if (j2)
+      h->cho = j1;
+    else
+      h->cho = 0;
     return true;
   }
   return false;
 }
 
-// Append unicode char to buffer string
-static void append_unichar(GString *s, uint32_t u) {
+// Queue a codepoint for commit. dkst_hangul_process() checks for room up
+// front, so this never overflows the caller's buffer.
+static void append_commit(DKSTHangul *h, uint32_t u) {
   if (u == 0)
     return;
-  g_string_append_unichar(s, u);
+  h->commit[h->commit_len++] = u;
+}
+
+// What a key does, given what the syllable holds and what the key types
+typedef enum {
+  ACT_PASS,         // Not a Hangul key: commit the syllable, don't consume
+  ACT_SYMBOL,       // Commit the syllable and the key's literal symbol
+  ACT_SET_CHO,      // Start a syllable with the initial
+  ACT_NEXT_CHO,     // Commit the lone initial and start a new one
+  ACT_COMBINE_CHO,  // Double the initial or start a new syllable (3-set)
+  ACT_START_CHO,    // Commit the syllable and start a new one (3-set)
+  ACT_ATTACH_CHO,   // Vowel typed first: put the initial in front (moa-jjiki)
+  ACT_ADD_JONG,     // Initial after a vowel becomes the final if it can
+  ACT_COMBINE_JONG, // Combine with the final or start a new syllable
+  ACT_SET_JUNG,     // Add the vowel
+  ACT_COMBINE_JUNG, // Combine with the vowel or start a new syllable
+  ACT_START_JUNG,   // Commit the syllable and start with the vowel (3-set)
+  ACT_MOVE_JONG,    // Vowel after a final: the final starts the next syllable
+  ACT_SET_JONG,     // Add the final (3-set)
+  ACT_COMBINE_FINAL, // Combine two finals or start with the final (3-set)
+  ACT_START_JONG,   // Commit the syllable and start with the final (3-set)
+} DKSTAction;
+
+// State is a bit set: 1 = choseong, 2 = jungseong, 4 = jongseong present
+#define STATE_OF(h)                                                            \
+  (((h)->cho != 0) | ((h)->jung != 0) << 1 | ((h)->jong != 0) << 2)
+
+// Indexed by [layout type][state][DKSTKeyClass]. In 2-set layouts a
+// consonant after a vowel becomes the final and moves on to the next
+// syllable if a vowel follows; 3-set layouts have dedicated final keys, so
+// every jamo stays where it was typed.
+static const uint8_t transitions[2][8][5] = {
+    [DKST_LAYOUT_2SET] =
+        {
+            //         NONE      CHO          JUNG          JONG      SYMBOL
+            /* -   */ {ACT_PASS, ACT_SET_CHO, ACT_SET_JUNG, ACT_PASS,
+                       ACT_SYMBOL},
+            /* C   */ {ACT_PASS, ACT_NEXT_CHO, ACT_SET_JUNG, ACT_PASS,
+                       ACT_SYMBOL},
+            /* V   */ {ACT_PASS, ACT_ATTACH_CHO, ACT_COMBINE_JUNG, ACT_PASS,
+                       ACT_SYMBOL},
+            /* CV  */ {ACT_PASS, ACT_ADD_JONG, ACT_COMBINE_JUNG, ACT_PASS,
+                       ACT_SYMBOL},
+            /* F   */ {ACT_PASS, ACT_SET_CHO, ACT_MOVE_JONG, ACT_PASS,
+                       ACT_SYMBOL},
+            /* CF  */ {ACT_PASS, ACT_NEXT_CHO, ACT_MOVE_JONG, ACT_PASS,
+                       ACT_SYMBOL},
+            /* VF  */ {ACT_PASS, ACT_COMBINE_JONG, ACT_MOVE_JONG, ACT_PASS,
+                       ACT_SYMBOL},
+            /* CVF */ {ACT_PASS, ACT_COMBINE_JONG, ACT_MOVE_JONG, ACT_PASS,
+                       ACT_SYMBOL},
+        },
+    [DKST_LAYOUT_3SET] =
+        {
+            /* -   */ {ACT_PASS, ACT_SET_CHO, ACT_SET_JUNG, ACT_START_JONG,
+                       ACT_SYMBOL},
+            /* C   */ {ACT_PASS, ACT_COMBINE_CHO, ACT_SET_JUNG,
+                       ACT_START_JONG, ACT_SYMBOL},
+            /* V   */ {ACT_PASS, ACT_ATTACH_CHO, ACT_COMBINE_JUNG,
+                       ACT_START_JONG, ACT_SYMBOL},
+            /* CV  */ {ACT_PASS, ACT_START_CHO, ACT_COMBINE_JUNG,
+                       ACT_SET_JONG, ACT_SYMBOL},
+            /* F   */ {ACT_PASS, ACT_START_CHO, ACT_START_JUNG,
+                       ACT_COMBINE_FINAL, ACT_SYMBOL},
+            /* CF  */ {ACT_PASS, ACT_START_CHO, ACT_START_JUNG,
+                       ACT_COMBINE_FINAL, ACT_SYMBOL},
+            /* VF  */ {ACT_PASS, ACT_START_CHO, ACT_START_JUNG,
+                       ACT_COMBINE_FINAL, ACT_SYMBOL},
+            /* CVF */ {ACT_PASS, ACT_START_CHO, ACT_START_JUNG,
+                       ACT_COMBINE_FINAL, ACT_SYMBOL},
+        },
+};
+
+// Commit the current syllable and start a new one with the given initial
+static void commit_and_start_cho(DKSTHangul *h, uint32_t cho) {
+  append_commit(h, dkst_hangul_current_syllable(h));
+  dkst_hangul_reset(h);
+  h->cho = cho;
 }
 
 bool dkst_hangul_process(DKSTHangul *h, char key) {
-  uint32_t hangul = map_key(key);
+  const DKSTLayout *layout = h->layout;
+  uint32_t hangul = map_key(layout, key);
+
+  if (h->commit_size - h->commit_len < DKST_HANGUL_MAX_COMMIT)
+    return false; // Caller must take the pending commit first
 
-  if (hangul == 0) {
+  switch (transitions[layout->type][STATE_OF(h)][key_class(layout, key)]) {
+  case ACT_PASS:
     // Not a hangul key. Commit current and return false (not consumed)
     if (h->cho || h->jung || h->jong) {
       uint32_t syl = dkst_hangul_current_syllable(h);
-      append_unichar(h->completed, syl);
+      append_commit(h, syl);
       dkst_hangul_reset(h);
     }
     return false;
+
+  case ACT_SYMBOL:
+    // Layout symbol (e.g. "·" in Sebeolsik). Commit current, then the symbol
+    append_commit(h, dkst_hangul_current_syllable(h));
+    dkst_hangul_reset(h);
+    append_commit(h, hangul);
+    break;
+
+  case ACT_SET_CHO:
+    h->cho = hangul;
+    break;
+
+  case ACT_NEXT_CHO:
+    append_commit(h, compatibility_jamo(h->cho));
+    h->cho = hangul;
+    break;
+
+  case ACT_COMBINE_CHO: {
+    uint32_t compound = combine_cho(layout, h->cho, hangul);
+    if (compound)
+      h->cho = compound;
+    else
+      commit_and_start_cho(h, hangul);
+    break;
   }
 
-  if (IS_CHO(hangul)) {
-    if (h->jung == 0) {
-      if (h->cho == 0) {
-        h->cho = hangul;
-      } else {
-        append_unichar(h->completed, compatibility_jamo(h->cho));
-        h->cho = hangul;
-        // No need to reset others as they are 0
-      }
+  case ACT_START_CHO:
+    commit_and_start_cho(h, hangul);
+    break;
+
+  case ACT_ATTACH_CHO:
+    // Jung only present
+    if (h->moa_jjiki_enabled)
+      h->cho = hangul;
+    else
+      commit_and_start_cho(h, hangul);
+    break;
+
+  case ACT_ADD_JONG: {
+    // Standard case: Cho+Jung. Incoming Cho might be Jong.
+    uint32_t as_jong = cho_to_jong(hangul);
+    if (as_jong)
+      h->jong = as_jong;
+    else
+      commit_and_start_cho(h, hangul);
+    break;
+  }
+
+  case ACT_COMBINE_JONG: {
+    // Cho+Jung+Jong. Incoming Cho might combine with Jong.
+    uint32_t compound = combine_jong(layout, h->jong, cho_to_jong(hangul));
+    if (compound)
+      h->jong = compound;
+    else
+      commit_and_start_cho(h, hangul);
+    break;
+  }
+
+  case ACT_SET_JUNG:
+    // Cho might be set or not
+    h->jung = hangul;
+    break;
+
+  case ACT_COMBINE_JUNG: {
+    uint32_t compound = combine_jung(layout, h->jung, hangul);
+    if (compound) {
+      h->jung = compound;
     } else {
-      // We have Cho and Jung
-      if (h->jong == 0) {
-        if (h->cho == 0) {
-          // Jung only present.
-          if (h->moa_jjiki_enabled) {
-            h->cho = hangul;
-            return true;
-          } else {
-            append_unichar(h->completed, dkst_hangul_current_syllable(h));
-            dkst_hangul_reset(h);
-            h->cho = hangul;
-            return true;
-          }
-        }
-
-        // Standard case: Cho+Jung. Incoming Cho might be Jong.
-        uint32_t as_jong = cho_to_jong(hangul);
-        if (as_jong) {
-          h->jong = as_jong;
-        } else {
-          append_unichar(h->completed, dkst_hangul_current_syllable(h));
-          dkst_hangul_reset(h);
-          h->cho = hangul;
-        }
-      } else {
-        // Cho+Jung+Jong. Incoming Cho might combine with Jong.
-        uint32_t compound = combine_jong(h->jong, cho_to_jong(hangul));
-        if (compound) {
-          h->jong = compound;
-        } else {
-          append_unichar(h->completed, dkst_hangul_current_syllable(h));
-          dkst_hangul_reset(h);
-          h->cho = hangul;
-        }
-      }
+      append_commit(h, dkst_hangul_current_syllable(h));
+      dkst_hangul_reset(h);
+      h->jung = hangul; // Assuming independent jung valid or moa-jjiki start
     }
-  } else if (IS_JUNG(hangul)) {
-    if (h->jong) {
-      uint32_t j1, j2;
-      split_jong(h->jong, &j1, &j2);
-      if (j2) {
-        // Complex jong. Split it. current becomes Cho+Jung+J1. Next is J2(as
-        // Cho)+NewJung
-        h->jong = j1;
-        uint32_t syl = dkst_hangul_current_syllable(h);
-        append_unichar(h->completed, syl);
-
-        uint32_t next_cho = jong_to_cho(j2);
-        dkst_hangul_reset(h);
-        h->cho = next_cho;
-        h->jung = hangul;
-      } else {
-        // Simple jong. It moves to next char as Cho.
-        uint32_t next_cho = jong_to_cho(h->jong);
-        h->jong = 0;
-        uint32_t syl = dkst_hangul_current_syllable(h);
-        append_unichar(h->completed, syl);
-
-        dkst_hangul_reset(h); // Clear
-        h->cho = next_cho;
-        h->jung = hangul;
-      }
-    } else if (h->jung) {
-      uint32_t compound = combine_jung(h->jung, hangul);
-      if (compound) {
-        h->jung = compound;
-      } else {
-        append_unichar(h->completed, dkst_hangul_current_syllable(h));
-        dkst_hangul_reset(h);
-        h->jung = hangul; // Assuming independent jung valid or moa-jjiki start
-      }
+    break;
+  }
+
+  case ACT_START_JUNG:
+    append_commit(h, dkst_hangul_current_syllable(h));
+    dkst_hangul_reset(h);
+    h->jung = hangul;
+    break;
+
+  case ACT_MOVE_JONG: {
+    uint32_t j1, j2;
+    split_jong(layout, h->jong, &j1, &j2);
+    // Complex jong keeps its first part; a simple one moves entirely.
+    // Either way the moved consonant becomes the next Cho.
+    h->jong = j2 ? j1 : 0;
+    uint32_t next_cho = jong_to_cho(j2 ? j2 : j1);
+    append_commit(h, dkst_hangul_current_syllable(h));
+    dkst_hangul_reset(h);
+    h->cho = next_cho;
+    h->jung = hangul;
+    break;
+  }
+
+  case ACT_SET_JONG:
+    h->jong = hangul;
+    break;
+
+  case ACT_COMBINE_FINAL: {
+    uint32_t compound = combine_jong(layout, h->jong, hangul);
+    if (compound) {
+      h->jong = compound;
     } else {
-      // Cho might be set or not
-      h->jung = hangul;
+      append_commit(h, dkst_hangul_current_syllable(h));
+      dkst_hangul_reset(h);
+      h->jong = hangul;
     }
+    break;
+  }
+
+  case ACT_START_JONG:
+    append_commit(h, dkst_hangul_current_syllable(h));
+    dkst_hangul_reset(h);
+    h->jong = hangul;
+    break;
   }
 
   return true;
 }
 
-char *dkst_hangul_get_commit_string(DKSTHangul *h) {
-  if (h->completed->len == 0)
-    return NULL;
-  char *ret = g_strdup(h->completed->str);
-  g_string_truncate(h->completed, 0);
-  return ret;
+// Encode u as UTF-8 into out (at least 4 bytes). Returns the byte count.
+static size_t utf8_encode(uint32_t u, char *out) {
+  if (u < 0x80) {
+    out[0] = (char)u;
+    return 1;
+  }
+  if (u < 0x800) {
+    out[0] = (char)(0xC0 | u >> 6);
+    out[1] = (char)(0x80 | (u & 0x3F));
+    return 2;
+  }
+  if (u < 0x10000) {
+    out[0] = (char)(0xE0 | u >> 12);
+    out[1] = (char)(0x80 | (u >> 6 & 0x3F));
+    out[2] = (char)(0x80 | (u & 0x3F));
+    return 3;
+  }
+  out[0] = (char)(0xF0 | u >> 18);
+  out[1] = (char)(0x80 | (u >> 12 & 0x3F));
+  out[2] = (char)(0x80 | (u >> 6 & 0x3F));
+  out[3] = (char)(0x80 | (u & 0x3F));
+  return 4;
+}
+
+size_t dkst_hangul_take_commit(DKSTHangul *h, char *buf, size_t size) {
+  size_t len = 0, taken = 0;
+
+  if (size == 0)
+    return 0;
+  while (taken < h->commit_len) {
+    char utf8[4];
+    size_t n = utf8_encode(h->commit[taken], utf8);
+    if (len + n >= size)
+      break; // Keep the rest pending for the next call
+    memcpy(buf + len, utf8, n);
+    len += n;
+    taken++;
+  }
+  buf[len] = '\0';
+
+  h->commit_len -= taken;
+  memmove(h->commit, h->commit + taken, h->commit_len * sizeof(uint32_t));
+  return len;
+}
+
+// Most UTF-8 bytes one key can produce in dkst_hangul_process_string(): its
+// commits plus the key itself if it passes through
+#define KEY_OUTPUT_MAX (DKST_HANGUL_MAX_COMMIT * 4 + 1)
+
+size_t dkst_hangul_process_string(DKSTHangul *h, const char *keys,
+                                  size_t len, char *out, size_t size,
+                                  size_t *consumed) {
+  size_t i = 0;
+
+  if (size == 0) {
+    if (consumed)
+      *consumed = 0;
+    return 0;
+  }
+  size_t n = dkst_hangul_take_commit(h, out, size);
+
+  // Pending commits from single-key calls go out first
+  if (h->commit_len == 0) {
+    for (; i < len && size - n > KEY_OUTPUT_MAX; i++) {
+      char key = keys[i];
+      bool used = key == '\b' ? dkst_hangul_backspace(h)
+                              : dkst_hangul_process(h, key);
+      for (size_t c = 0; c < h->commit_len; c++)
+        n += utf8_encode(h->commit[c], out + n);
+      h->commit_len = 0;
+      if (used) {
+        continue;
+      } else if (key != '\b') {
+        out[n++] = key;
+      } else if (n > 0 && out[n - 1] != '\n') {
+        // Delete the last character written, as the text would have it
+        do
+          n--;
+        while (n > 0 && (out[n] & 0xC0) == 0x80);
+      }
+    }
+    out[n] = '\0';
+  }
+
+  if (consumed)
+    *consumed = i;
+  return n;
+}
+
+bool dkst_hangul_flush(DKSTHangul *h) {
+  uint32_t syl = dkst_hangul_current_syllable(h);
+  if (syl && h->commit_len == h->commit_size)
+    return false;
+  append_commit(h, syl);
+  dkst_hangul_reset(h);
+  return true;
 }
 
-bool dkst_hangul_has_composed(DKSTHangul *h) {
+bool dkst_hangul_has_composed(const DKSTHangul *h) {
   return (h->cho || h->jung || h->jong);
 }
@@ -2,45 +2,87 @@
 #ifndef HANGUL_H
 #define HANGUL_H
 
-#include <glib.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
+// The composition core is plain C: it never allocates and keeps no global
+// state, so any number of instances can run on any threads. Committed
+// codepoints go to a buffer the caller provides.
+
 typedef enum { DKST_BACKSPACE_JASO, DKST_BACKSPACE_CHAR } DKSTBackspaceMode;
 
+// Keyboard layout tables, generated from layouts/*.layout
+struct DKSTLayout;
+
+// Most codepoints one key can commit (the finished syllable and a symbol)
+#define DKST_HANGUL_MAX_COMMIT 2
+
 typedef struct {
   uint32_t cho;
   uint32_t jung;
   uint32_t jong;
-  GString *buffer;    // Internal buffer for raw keys if needed, though we track
-                      // state mostly
-  GString *completed; // Queue of completed characters to commit
+  uint32_t *commit;   // Caller's buffer of completed codepoints to commit
+  size_t commit_len;  // Codepoints pending in commit
+  size_t commit_size; // Capacity of commit, in codepoints
   bool moa_jjiki_enabled;
   DKSTBackspaceMode backspace_mode;
+  const struct DKSTLayout *layout; // Dubeolsik unless set otherwise
 } DKSTHangul;
 
-// Initialize
-void dkst_hangul_init(DKSTHangul *h);
+// Initialize. commit_buf holds commit_size codepoints (at least
+// DKST_HANGUL_MAX_COMMIT) and must outlive h.
+void dkst_hangul_init(DKSTHangul *h, uint32_t *commit_buf,
+                      size_t commit_size);
 
 // Reset state
 void dkst_hangul_reset(DKSTHangul *h);
 
-// Cleanup (free memory)
-void dkst_hangul_free(DKSTHangul *h);
+// Select a keyboard layout by name ("dubeolsik", "sebeolsik-390",
+// "sebeolsik-final"). Resets the composition state. Returns false (keeping
+// the current layout) if the name is unknown.
+bool dkst_hangul_set_layout(DKSTHangul *h, const char *name);
 
 // Process a key code (ascii char). Returns true if consumed, false otherwise.
+// Also returns false, leaving the state alone, if the commit buffer has
+// fewer than DKST_HANGUL_MAX_COMMIT free slots.
 bool dkst_hangul_process(DKSTHangul *h, char key);
 
 // Get the current composed character (0 if none)
-uint32_t dkst_hangul_current_syllable(DKSTHangul *h);
+uint32_t dkst_hangul_current_syllable(const DKSTHangul *h);
+
+// Move pending committed text into buf as NUL-terminated UTF-8. Whatever
+// does not fit in size bytes stays pending. Returns the bytes written (0 if
+// nothing was pending).
+size_t dkst_hangul_take_commit(DKSTHangul *h, char *buf, size_t size);
+
+// Run a buffer of keys through the automaton in one pass, as if each went
+// through dkst_hangul_process() (or dkst_hangul_backspace() for '\b') with
+// its commit taken right after. Keys the automaton does not consume are
+// copied to out as they are, so non-Hangul text (including UTF-8) passes
+// through, except '\b': one with nothing to take back in the automaton
+// deletes the last character this call wrote to out. Like line editing in
+// a terminal, it is dropped instead if there is none or that character is
+// a newline, so lines stay independent. Writes NUL-terminated UTF-8 to out
+// and returns the bytes written.
+// Stops early when out is nearly full (it needs more than
+// DKST_HANGUL_MAX_COMMIT * 4 + 1 bytes free to take a key); *consumed (if not
+// NULL) is set to the number of keys processed. The syllable still being
+// composed stays in h. With size 0 nothing is written, not even the NUL.
+size_t dkst_hangul_process_string(DKSTHangul *h, const char *keys,
+                                  size_t len, char *out, size_t size,
+                                  size_t *consumed);
 
-// Get pending committed string (caller must free)
-char *dkst_hangul_get_commit_string(DKSTHangul *h);
+// Commit the syllable being composed (taken with dkst_hangul_take_commit())
+// and reset the state, as when the user moves focus away. Returns false,
+// leaving the state alone, if the commit buffer is full; take the pending
+// commits and flush again.
+bool dkst_hangul_flush(DKSTHangul *h);
 
 // Backspace handling. Returns true if state changed.
 bool dkst_hangul_backspace(DKSTHangul *h);
 
 // Helper to check if string has any composed content
-bool dkst_hangul_has_composed(DKSTHangul *h);
+bool dkst_hangul_has_composed(const DKSTHangul *h);
 
 #endif
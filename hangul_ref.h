@@ -0,0 +1,41 @@
+// Golden reference for the composition automaton: the original Dubeolsik
+// implementation, frozen. test_hangul_exhaustive compares hangul.c against
+// it; it is not linked into the engine.
+#ifndef HANGUL_REF_H
+#define HANGUL_REF_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Room for the characters completed between two drains (one key completes
+// at most one)
+#define REF_HANGUL_MAX_COMPLETED 8
+
+typedef enum { REF_BACKSPACE_JASO, REF_BACKSPACE_CHAR } RefBackspaceMode;
+
+typedef struct {
+  uint32_t cho;
+  uint32_t jung;
+  uint32_t jong;
+  uint32_t completed[REF_HANGUL_MAX_COMPLETED]; // Queue of completed characters
+  size_t completed_len; // Cleared by the caller once consumed
+  bool moa_jjiki_enabled;
+  RefBackspaceMode backspace_mode;
+} RefHangul;
+
+void ref_hangul_init(RefHangul *h);
+void ref_hangul_reset(RefHangul *h);
+
+// Process a key code (ascii char). Returns true if consumed, false otherwise.
+bool ref_hangul_process(RefHangul *h, char key);
+
+// Get the current composed character (0 if none)
+uint32_t ref_hangul_current_syllable(RefHangul *h);
+
+// Backspace handling. Returns true if state changed.
+bool ref_hangul_backspace(RefHangul *h);
+
+bool ref_hangul_has_composed(RefHangul *h);
+
+#endif
@@ -1,202 +1,860 @@
 
 #include "hanja_dict.h"
-#include <stdio.h>
+#include "trace.h"
+#include <glib/gstdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-// Debug logging (disabled for production)
-static void debug_log(const char *fmt, ...) {
-  // Uncomment for debugging:
-  // va_list args;
-  // va_start(args, fmt);
-  // vfprintf(stderr, fmt, args);
-  // va_end(args);
+// --- Dictionary table layout ---
+// The compiled image (hanja.dict) and the arena built in memory from a text
+// dictionary share one struct-of-arrays layout. All integers are
+// little-endian, offsets are relative to the start of the table:
+//   HanjaImageHeader
+//   guint32 key_strings[n_keys]     key string offsets, sorted by strcmp()
+//   guint32 key_first[n_keys + 1]   candidates of key i are the run
+//                                   [key_first[i], key_first[i + 1])
+//   guint32 cand_text[n_candidates] commit text offsets ("韓")
+//   guint32 cand_note[n_candidates] annotation offsets ("(한국 한)" or "")
+//   guint32 node_first[n_nodes + 1] edges of trie node i are the run
+//                                   [node_first[i], node_first[i + 1])
+//   guint32 node_key[n_nodes]       key index + 1 ending at node i, or 0
+//   guint32 edge_label[n_edges]     codepoint, ascending within a node
+//   guint32 edge_target[n_edges]    child node index
+//   char strings[strings_size]      NUL-terminated UTF-8 string pool
+// Lookups binary-search key_strings directly on the table, so mapping an
+// image is O(1) and its pages are shared through the page cache.
+//
+// The trie indexes every key by its codepoints in reverse order (node 0 is
+// the root), so walking it backwards from the end of the typed text finds
+// all keys that are suffixes of the text in a single O(length) pass.
+#define HANJA_IMAGE_MAGIC "DKSTHNJ"
+#define HANJA_IMAGE_VERSION 3
+
+typedef struct {
+  char magic[8];
+  guint32 version;
+  guint32 n_keys;
+  guint32 n_candidates;
+  guint32 key_strings_offset;
+  guint32 key_first_offset;
+  guint32 cand_text_offset;
+  guint32 cand_note_offset;
+  guint32 n_nodes;
+  guint32 n_edges;
+  guint32 node_first_offset;
+  guint32 node_key_offset;
+  guint32 edge_label_offset;
+  guint32 edge_target_offset;
+  guint32 strings_offset;
+  guint32 strings_size;
+} HanjaImageHeader;
+
+// Check that an array of n guint32 at offset fits in size
+static bool section_fits(guint32 offset, guint64 n, gsize size) {
+  return offset % sizeof(guint32) == 0 &&
+         (guint64)offset + n * sizeof(guint32) <= size;
 }
 
-// Free a GPtrArray of strings stored in hash table
-static void free_candidates(gpointer data) {
-  GPtrArray *arr = (GPtrArray *)data;
-  if (arr) {
-    g_ptr_array_unref(arr);
-  }
+// Validate a table and attach it. Only the header and section bounds are
+// checked here (O(1)); offsets are bounds-checked when dereferenced.
+static bool table_attach(HanjaTable *table, const char *data, gsize size) {
+  if (!data || size < sizeof(HanjaImageHeader))
+    return false;
+
+  const HanjaImageHeader *hdr = (const HanjaImageHeader *)data;
+  if (memcmp(hdr->magic, HANJA_IMAGE_MAGIC, sizeof(hdr->magic)) != 0 ||
+      GUINT32_FROM_LE(hdr->version) != HANJA_IMAGE_VERSION)
+    return false;
+
+  guint64 n_keys = GUINT32_FROM_LE(hdr->n_keys);
+  guint64 n_cands = GUINT32_FROM_LE(hdr->n_candidates);
+  guint64 n_nodes = GUINT32_FROM_LE(hdr->n_nodes);
+  guint64 n_edges = GUINT32_FROM_LE(hdr->n_edges);
+  guint64 strings_offset = GUINT32_FROM_LE(hdr->strings_offset);
+  guint64 strings_size = GUINT32_FROM_LE(hdr->strings_size);
+
+  if (!section_fits(GUINT32_FROM_LE(hdr->key_strings_offset), n_keys, size) ||
+      !section_fits(GUINT32_FROM_LE(hdr->key_first_offset), n_keys + 1,
+                    size) ||
+      !section_fits(GUINT32_FROM_LE(hdr->cand_text_offset), n_cands, size) ||
+      !section_fits(GUINT32_FROM_LE(hdr->cand_note_offset), n_cands, size) ||
+      n_nodes == 0 ||
+      !section_fits(GUINT32_FROM_LE(hdr->node_first_offset), n_nodes + 1,
+                    size) ||
+      !section_fits(GUINT32_FROM_LE(hdr->node_key_offset), n_nodes, size) ||
+      !section_fits(GUINT32_FROM_LE(hdr->edge_label_offset), n_edges, size) ||
+      !section_fits(GUINT32_FROM_LE(hdr->edge_target_offset), n_edges,
+                    size) ||
+      strings_size == 0 || strings_offset + strings_size > size)
+    return false;
+
+  // The pool must end with a terminator so every string is bounded
+  if (data[strings_offset + strings_size - 1] != '\0')
+    return false;
+
+  table->data = data;
+  table->size = size;
+  return true;
 }
 
-// Parse a dictionary file and populate hash table
-// Format: hangul:hanja1,hanja2,...
-static bool load_dict_file(GHashTable *dict, const char *path) {
-  if (!path)
+static HanjaTable *table_new(void) {
+  HanjaTable *table = g_new0(HanjaTable, 1);
+  table->ref_count = 1;
+  return table;
+}
+
+static HanjaTable *table_ref(HanjaTable *table) {
+  g_atomic_int_inc(&table->ref_count);
+  return table;
+}
+
+static void table_unref(HanjaTable *table) {
+  if (!g_atomic_int_dec_and_test(&table->ref_count))
+    return;
+
+  if (table->mapped)
+    g_mapped_file_unref(table->mapped);
+  g_free(table->arena);
+  g_free(table);
+}
+
+static const HanjaImageHeader *table_header(const HanjaTable *table) {
+  return (const HanjaImageHeader *)table->data;
+}
+
+static guint32 table_u32(const HanjaTable *table, guint32 section,
+                         guint32 index) {
+  const guint32 *array =
+      (const guint32 *)(table->data + GUINT32_FROM_LE(section));
+  return GUINT32_FROM_LE(array[index]);
+}
+
+static const char *table_string(const HanjaTable *table, guint32 offset) {
+  const HanjaImageHeader *hdr = table_header(table);
+  if (offset >= GUINT32_FROM_LE(hdr->strings_size))
+    return "";
+  return table->data + GUINT32_FROM_LE(hdr->strings_offset) + offset;
+}
+
+// Candidate run of the key at index
+static bool table_key_run(const HanjaTable *table, guint32 key,
+                          guint32 *first, guint32 *count) {
+  const HanjaImageHeader *hdr = table_header(table);
+  if (key >= GUINT32_FROM_LE(hdr->n_keys))
+    return false;
+
+  guint32 start = table_u32(table, hdr->key_first_offset, key);
+  guint32 end = table_u32(table, hdr->key_first_offset, key + 1);
+  if (start > end || end > GUINT32_FROM_LE(hdr->n_candidates))
     return false;
+  *first = start;
+  *count = end - start;
+  return true;
+}
 
-  FILE *fp = fopen(path, "r");
-  if (!fp) {
-    debug_log("Failed to open dictionary: %s\n", path);
+// Binary search for a key; returns its candidate run
+static bool table_find(const HanjaTable *table, const char *hangul,
+                       guint32 *first, guint32 *count) {
+  const HanjaImageHeader *hdr = table_header(table);
+  if (!hdr)
     return false;
+
+  guint32 lo = 0;
+  guint32 hi = GUINT32_FROM_LE(hdr->n_keys);
+
+  while (lo < hi) {
+    guint32 mid = lo + (hi - lo) / 2;
+    const char *key =
+        table_string(table, table_u32(table, hdr->key_strings_offset, mid));
+    int cmp = strcmp(hangul, key);
+    if (cmp < 0) {
+      hi = mid;
+    } else if (cmp > 0) {
+      lo = mid + 1;
+    } else {
+      return table_key_run(table, mid, first, count);
+    }
+  }
+  return false;
+}
+
+// A key found by walking the reversed-key trie
+typedef struct {
+  const char *start; // Where the matching suffix starts in the text
+  guint32 key;       // Key index in the table
+} SuffixMatch;
+
+// Child of node for codepoint, or -1
+static gint64 trie_child(const HanjaTable *table, guint32 node,
+                         gunichar label) {
+  const HanjaImageHeader *hdr = table_header(table);
+  guint32 lo = table_u32(table, hdr->node_first_offset, node);
+  guint32 hi = table_u32(table, hdr->node_first_offset, node + 1);
+  if (lo > hi || hi > GUINT32_FROM_LE(hdr->n_edges))
+    return -1;
+
+  while (lo < hi) {
+    guint32 mid = lo + (hi - lo) / 2;
+    guint32 cp = table_u32(table, hdr->edge_label_offset, mid);
+    if (label < cp) {
+      hi = mid;
+    } else if (label > cp) {
+      lo = mid + 1;
+    } else {
+      guint32 child = table_u32(table, hdr->edge_target_offset, mid);
+      return child < GUINT32_FROM_LE(hdr->n_nodes) ? child : -1;
+    }
   }
+  return -1;
+}
 
-  char line[1024];
-  int count = 0;
+// Walk the trie backwards from the end of text, collecting every key that
+// is a suffix of it (shortest first). Past max_matches (at least 2), the
+// shortest stays in out[0] and the longest others go round a ring in the
+// rest of out, which is put back in order at the end. Returns the number
+// of matches kept.
+static guint table_match_suffixes(const HanjaTable *table, const char *text,
+                                  const char *end, SuffixMatch *out,
+                                  guint max_matches) {
+  const HanjaImageHeader *hdr = table_header(table);
+  if (!hdr)
+    return 0;
+
+  guint n = 0;
+  guint ring = max_matches - 1;
+  guint32 node = 0;
+  const char *p = end;
+
+  while (p > text) {
+    p = g_utf8_find_prev_char(text, p);
+    if (!p)
+      break;
+
+    gint64 child = trie_child(table, node, g_utf8_get_char(p));
+    if (child < 0)
+      break;
+    node = (guint32)child;
+
+    guint32 key = table_u32(table, hdr->node_key_offset, node);
+    if (key > 0) {
+      guint slot = n < max_matches ? n : 1 + (n - 1) % ring;
+      out[slot].start = p;
+      out[slot].key = key - 1;
+      n++;
+    }
+  }
 
-  while (fgets(line, sizeof(line), fp)) {
-    // Remove newline
-    size_t len = strlen(line);
-    if (len > 0 && line[len - 1] == '\n')
-      line[len - 1] = '\0';
-    if (len > 1 && line[len - 2] == '\r')
-      line[len - 2] = '\0';
+  if (n > max_matches) {
+    // The oldest (shortest) entry left in the ring is where the next would go
+    guint oldest = (n - 1) % ring;
+    SuffixMatch tmp[HANJA_MAX_SUFFIX_MATCHES];
+    memcpy(tmp, out + 1, oldest * sizeof(SuffixMatch));
+    memmove(out + 1, out + 1 + oldest, (ring - oldest) * sizeof(SuffixMatch));
+    memcpy(out + 1 + ring - oldest, tmp, oldest * sizeof(SuffixMatch));
+    n = max_matches;
+  }
+  return n;
+}
 
-    // Skip empty lines
-    if (line[0] == '\0' || line[0] == '#')
-      continue;
+// --- Building tables from text ---
+// Format: hangul:hanja1 (note),hanja2 (note),...
+
+typedef struct {
+  guint32 key;  // Offsets into the scratch pool
+  guint32 text;
+  guint32 note;
+  guint32 seq;  // Input order, keeps candidate order stable when sorting
+} BuildEntry;
+
+static guint32 pool_add(GByteArray *pool, const char *str, gsize len) {
+  guint32 offset = pool->len;
+  g_byte_array_append(pool, (const guint8 *)str, len);
+  g_byte_array_append(pool, (const guint8 *)"", 1);
+  return offset;
+}
 
-    // Find colon separator
-    char *colon = strchr(line, ':');
-    if (!colon)
-      continue;
+// Trim ASCII whitespace from both ends of [*str, *str + *len)
+static void trim(const char **str, gsize *len) {
+  while (*len > 0 && g_ascii_isspace((*str)[0])) {
+    (*str)++;
+    (*len)--;
+  }
+  while (*len > 0 && g_ascii_isspace((*str)[*len - 1]))
+    (*len)--;
+}
 
-    // Extract key (hangul)
-    *colon = '\0';
-    char *key = g_strstrip(g_strdup(line));
+static void parse_line(const char *line, gsize len, GByteArray *pool,
+                       GArray *entries) {
+  trim(&line, &len);
 
-    // Extract values (hanja list)
-    char *values_str = colon + 1;
+  // Skip empty lines and comments
+  if (len == 0 || line[0] == '#')
+    return;
 
-    // Split by comma
-    gchar **values = g_strsplit(values_str, ",", -1);
-    if (!values || !values[0]) {
-      g_free(key);
-      g_strfreev(values);
-      continue;
+  // Find colon separator
+  const char *colon = memchr(line, ':', len);
+  if (!colon)
+    return;
+
+  const char *key = line;
+  gsize key_len = colon - line;
+  trim(&key, &key_len);
+
+  guint32 key_offset = 0;
+  gboolean have_key = FALSE;
+  const char *value = colon + 1;
+  const char *end = line + len;
+
+  // Split by comma; each value is "text" or "text annotation"
+  while (value <= end) {
+    const char *comma = memchr(value, ',', end - value);
+    if (!comma)
+      comma = end;
+
+    const char *text = value;
+    gsize text_len = comma - value;
+    trim(&text, &text_len);
+
+    if (text_len > 0) {
+      if (!have_key) {
+        key_offset = pool_add(pool, key, key_len);
+        have_key = TRUE;
+      }
+
+      // Pre-split "韓 (한국 한)" into commit text and annotation
+      const char *space = memchr(text, ' ', text_len);
+      const char *note = space ? space : text + text_len;
+      gsize note_len = text + text_len - note;
+      trim(&note, &note_len);
+
+      BuildEntry entry;
+      entry.key = key_offset;
+      entry.text = pool_add(pool, text, (space ? space : note) - text);
+      entry.note = note_len > 0 ? pool_add(pool, note, note_len) : 0;
+      entry.seq = entries->len;
+      g_array_append_val(entries, entry);
     }
+    value = comma + 1;
+  }
+}
 
-    // Create array for candidates
-    GPtrArray *candidates = g_ptr_array_new_with_free_func(g_free);
+static gint compare_entries(gconstpointer a, gconstpointer b,
+                            gpointer user_data) {
+  const char *pool = user_data;
+  const BuildEntry *ea = a;
+  const BuildEntry *eb = b;
+  int cmp = strcmp(pool + ea->key, pool + eb->key);
+  if (cmp != 0)
+    return cmp;
+  return ea->seq < eb->seq ? -1 : ea->seq > eb->seq;
+}
 
-    for (int i = 0; values[i] != NULL; i++) {
-      gchar *trimmed = g_strstrip(g_strdup(values[i]));
-      if (trimmed && *trimmed) {
-        g_ptr_array_add(candidates, trimmed);
-      } else {
-        g_free(trimmed);
-      }
+static void put_u32(GByteArray *out, guint32 value) {
+  guint32 le = GUINT32_TO_LE(value);
+  g_byte_array_append(out, (const guint8 *)&le, sizeof(le));
+}
+
+// A key spelled backwards, as a run in the reversed codepoint buffer
+typedef struct {
+  guint32 offset;
+  guint32 length;
+  guint32 key;
+} ReversedKey;
+
+static gint compare_reversed(gconstpointer a, gconstpointer b,
+                             gpointer user_data) {
+  const gunichar *cps = user_data;
+  const ReversedKey *ra = a;
+  const ReversedKey *rb = b;
+  guint32 n = MIN(ra->length, rb->length);
+  for (guint32 i = 0; i < n; i++) {
+    gunichar ca = cps[ra->offset + i];
+    gunichar cb = cps[rb->offset + i];
+    if (ca != cb)
+      return ca < cb ? -1 : 1;
+  }
+  return ra->length < rb->length ? -1 : ra->length > rb->length;
+}
+
+// A trie node under construction: the reversed keys sharing its prefix
+typedef struct {
+  guint32 lo;
+  guint32 hi;
+  guint32 depth;
+} TrieRange;
+
+// Build the reversed-key trie. Nodes are numbered breadth-first, so the
+// edges of each node are emitted as one contiguous, label-sorted run.
+static void build_trie(const char *pool, GArray *key_offsets,
+                       GByteArray *node_first, GByteArray *node_key,
+                       GByteArray *edge_label, GByteArray *edge_target,
+                       guint32 *n_nodes, guint32 *n_edges) {
+  GArray *cps = g_array_new(FALSE, FALSE, sizeof(gunichar));
+  GArray *keys = g_array_new(FALSE, FALSE, sizeof(ReversedKey));
+
+  for (guint i = 0; i < key_offsets->len; i++) {
+    const char *key = pool + g_array_index(key_offsets, guint32, i);
+    if (!g_utf8_validate(key, -1, NULL))
+      continue;
+
+    ReversedKey rk = {cps->len, 0, i};
+    for (const char *p = key + strlen(key); p > key;) {
+      p = g_utf8_prev_char(p);
+      gunichar cp = g_utf8_get_char(p);
+      g_array_append_val(cps, cp);
+      rk.length++;
+    }
+    if (rk.length > 0)
+      g_array_append_val(keys, rk);
+  }
+  g_array_sort_with_data(keys, compare_reversed, cps->data);
+
+  const gunichar *cp_data = (const gunichar *)cps->data;
+  GArray *nodes = g_array_new(FALSE, FALSE, sizeof(TrieRange));
+  TrieRange root = {0, keys->len, 0};
+  g_array_append_val(nodes, root);
+  guint32 edges = 0;
+
+  for (guint id = 0; id < nodes->len; id++) {
+    TrieRange range = g_array_index(nodes, TrieRange, id);
+    guint32 lo = range.lo;
+
+    // Shorter keys sort first: a key ending exactly here comes first
+    guint32 key_here = 0;
+    if (lo < range.hi &&
+        g_array_index(keys, ReversedKey, lo).length == range.depth) {
+      key_here = g_array_index(keys, ReversedKey, lo).key + 1;
+      lo++;
     }
-    g_strfreev(values);
-
-    if (candidates->len > 0) {
-      // If key exists, append to existing candidates
-      GPtrArray *existing = (GPtrArray *)g_hash_table_lookup(dict, key);
-      if (existing) {
-        for (guint i = 0; i < candidates->len; i++) {
-          g_ptr_array_add(existing,
-                          g_strdup((char *)g_ptr_array_index(candidates, i)));
-        }
-        g_ptr_array_unref(candidates);
-        g_free(key);
-      } else {
-        g_hash_table_insert(dict, key, candidates);
-        count++;
+    put_u32(node_first, edges);
+    put_u32(node_key, key_here);
+
+    while (lo < range.hi) {
+      const ReversedKey *rk = &g_array_index(keys, ReversedKey, lo);
+      gunichar label = cp_data[rk->offset + range.depth];
+      guint32 end = lo + 1;
+      while (end < range.hi) {
+        const ReversedKey *next = &g_array_index(keys, ReversedKey, end);
+        if (cp_data[next->offset + range.depth] != label)
+          break;
+        end++;
       }
-    } else {
-      g_ptr_array_unref(candidates);
-      g_free(key);
+
+      TrieRange child = {lo, end, range.depth + 1};
+      put_u32(edge_label, label);
+      put_u32(edge_target, nodes->len);
+      g_array_append_val(nodes, child);
+      edges++;
+      lo = end;
     }
   }
+  put_u32(node_first, edges);
 
-  fclose(fp);
-  debug_log("Loaded %d entries from %s\n", count, path);
+  *n_nodes = nodes->len;
+  *n_edges = edges;
+
+  g_array_free(nodes, TRUE);
+  g_array_free(keys, TRUE);
+  g_array_free(cps, TRUE);
+}
+
+// Build a table from dictionary text. Keys and candidates end up in one
+// contiguous allocation; repeated keys are merged in input order.
+static GByteArray *build_table(const char *text, gsize len) {
+  GByteArray *scratch = g_byte_array_new();
+  GArray *entries = g_array_new(FALSE, FALSE, sizeof(BuildEntry));
+  g_byte_array_append(scratch, (const guint8 *)"", 1);
+
+  const char *line = text;
+  const char *end = text + len;
+  while (line < end) {
+    const char *nl = memchr(line, '\n', end - line);
+    if (!nl)
+      nl = end;
+    parse_line(line, nl - line, scratch, entries);
+    line = nl + 1;
+  }
+
+  g_array_sort_with_data(entries, compare_entries, scratch->data);
+
+  // Offset 0 of the final pool is the shared empty string
+  GByteArray *strings = g_byte_array_new();
+  GByteArray *key_strings = g_byte_array_new();
+  GByteArray *key_first = g_byte_array_new();
+  GByteArray *cand_text = g_byte_array_new();
+  GByteArray *cand_note = g_byte_array_new();
+  GArray *key_offsets = g_array_new(FALSE, FALSE, sizeof(guint32));
+  g_byte_array_append(strings, (const guint8 *)"", 1);
+
+  const char *scratch_pool = (const char *)scratch->data;
+  const char *prev_key = NULL;
+  guint32 n_keys = 0;
+
+  for (guint i = 0; i < entries->len; i++) {
+    const BuildEntry *entry = &g_array_index(entries, BuildEntry, i);
+    const char *key = scratch_pool + entry->key;
+
+    if (!prev_key || strcmp(prev_key, key) != 0) {
+      guint32 key_offset = pool_add(strings, key, strlen(key));
+      g_array_append_val(key_offsets, key_offset);
+      put_u32(key_strings, key_offset);
+      put_u32(key_first, i);
+      prev_key = key;
+      n_keys++;
+    }
+
+    const char *cand = scratch_pool + entry->text;
+    put_u32(cand_text, pool_add(strings, cand, strlen(cand)));
+    const char *note = scratch_pool + entry->note;
+    put_u32(cand_note, *note ? pool_add(strings, note, strlen(note)) : 0);
+  }
+  put_u32(key_first, entries->len);
+
+  GByteArray *node_first = g_byte_array_new();
+  GByteArray *node_key = g_byte_array_new();
+  GByteArray *edge_label = g_byte_array_new();
+  GByteArray *edge_target = g_byte_array_new();
+  guint32 n_nodes = 0;
+  guint32 n_edges = 0;
+  build_trie((const char *)strings->data, key_offsets, node_first, node_key,
+             edge_label, edge_target, &n_nodes, &n_edges);
+
+  HanjaImageHeader hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  memcpy(hdr.magic, HANJA_IMAGE_MAGIC, sizeof(hdr.magic));
+  guint32 offset = sizeof(hdr);
+  hdr.version = GUINT32_TO_LE(HANJA_IMAGE_VERSION);
+  hdr.n_keys = GUINT32_TO_LE(n_keys);
+  hdr.n_candidates = GUINT32_TO_LE(entries->len);
+  hdr.key_strings_offset = GUINT32_TO_LE(offset);
+  offset += key_strings->len;
+  hdr.key_first_offset = GUINT32_TO_LE(offset);
+  offset += key_first->len;
+  hdr.cand_text_offset = GUINT32_TO_LE(offset);
+  offset += cand_text->len;
+  hdr.cand_note_offset = GUINT32_TO_LE(offset);
+  offset += cand_note->len;
+  hdr.n_nodes = GUINT32_TO_LE(n_nodes);
+  hdr.n_edges = GUINT32_TO_LE(n_edges);
+  hdr.node_first_offset = GUINT32_TO_LE(offset);
+  offset += node_first->len;
+  hdr.node_key_offset = GUINT32_TO_LE(offset);
+  offset += node_key->len;
+  hdr.edge_label_offset = GUINT32_TO_LE(offset);
+  offset += edge_label->len;
+  hdr.edge_target_offset = GUINT32_TO_LE(offset);
+  offset += edge_target->len;
+  hdr.strings_offset = GUINT32_TO_LE(offset);
+  hdr.strings_size = GUINT32_TO_LE(strings->len);
+
+  GByteArray *table = g_byte_array_sized_new(offset + strings->len);
+  g_byte_array_append(table, (const guint8 *)&hdr, sizeof(hdr));
+  g_byte_array_append(table, key_strings->data, key_strings->len);
+  g_byte_array_append(table, key_first->data, key_first->len);
+  g_byte_array_append(table, cand_text->data, cand_text->len);
+  g_byte_array_append(table, cand_note->data, cand_note->len);
+  g_byte_array_append(table, node_first->data, node_first->len);
+  g_byte_array_append(table, node_key->data, node_key->len);
+  g_byte_array_append(table, edge_label->data, edge_label->len);
+  g_byte_array_append(table, edge_target->data, edge_target->len);
+  g_byte_array_append(table, strings->data, strings->len);
+
+  dkst_trace(DKST_TRACE_DICT_TABLE_BUILT, n_keys, entries->len, table->len);
+
+  g_byte_array_unref(edge_target);
+  g_byte_array_unref(edge_label);
+  g_byte_array_unref(node_key);
+  g_byte_array_unref(node_first);
+  g_array_free(key_offsets, TRUE);
+  g_byte_array_unref(cand_note);
+  g_byte_array_unref(cand_text);
+  g_byte_array_unref(key_first);
+  g_byte_array_unref(key_strings);
+  g_byte_array_unref(strings);
+  g_array_free(entries, TRUE);
+  g_byte_array_unref(scratch);
+  return table;
+}
+
+// Parse a text dictionary file into a table
+static GByteArray *build_table_from_file(const char *path) {
+  GMappedFile *file = g_mapped_file_new(path, FALSE, NULL);
+  if (!file) {
+    dkst_trace(DKST_TRACE_DICT_OPEN_FAILED, 0, 0, 0);
+    return NULL;
+  }
+
+  GByteArray *table = build_table(g_mapped_file_get_contents(file),
+                                  g_mapped_file_get_length(file));
+  g_mapped_file_unref(file);
+  return table;
+}
+
+static bool load_dict_file(HanjaTable *table, const char *path) {
+  if (!path)
+    return false;
+
+  GByteArray *built = build_table_from_file(path);
+  if (!built)
+    return false;
+
+  gsize size = built->len;
+  table->arena = g_byte_array_free(built, FALSE);
+  if (!table_attach(table, (const char *)table->arena, size)) {
+    g_free(table->arena);
+    table->arena = NULL;
+    return false;
+  }
+
+  dkst_trace(DKST_TRACE_DICT_ARENA_LOADED, size, 0, 0);
   return true;
 }
 
-bool hanja_dict_init(HanjaDict *dict, const char *system_path,
-                     const char *user_path) {
-  if (!dict)
+static bool load_dict_image(HanjaTable *table, const char *path) {
+  GMappedFile *image = g_mapped_file_new(path, FALSE, NULL);
+  if (!image)
     return false;
 
-  // Create hash tables
-  dict->system_dict =
-      g_hash_table_new_full(g_str_hash, g_str_equal, g_free, free_candidates);
-  dict->user_dict =
-      g_hash_table_new_full(g_str_hash, g_str_equal, g_free, free_candidates);
+  if (!table_attach(table, g_mapped_file_get_contents(image),
+                    g_mapped_file_get_length(image))) {
+    g_mapped_file_unref(image);
+    return false;
+  }
 
-  // Load system dictionary
-  if (system_path) {
-    load_dict_file(dict->system_dict, system_path);
+  table->mapped = image;
+  dkst_trace(DKST_TRACE_DICT_IMAGE_MAPPED, 0, 0, 0);
+  return true;
+}
+
+HanjaDict *hanja_dict_new(const char *system_path, const char *user_path) {
+  HanjaDict *dict = g_new0(HanjaDict, 1);
+  dict->ref_count = 1;
+  dict->system = table_new();
+  dict->user = table_new();
+
+  // Load system dictionary: map a compiled image, fall back to parsing text
+  if (system_path && !load_dict_image(dict->system, system_path)) {
+    load_dict_file(dict->system, system_path);
   }
 
   // Load user dictionary
   if (user_path) {
-    load_dict_file(dict->user_dict, user_path);
+    load_dict_file(dict->user, user_path);
   }
 
-  return true;
+  return dict;
 }
 
-GPtrArray *hanja_dict_lookup(HanjaDict *dict, const char *hangul) {
-  if (!dict || !hangul || !*hangul)
-    return NULL;
+// Overridable so the headless harness can use the dictionaries in the tree
+#ifndef HANJA_SYSTEM_IMAGE
+#define HANJA_SYSTEM_IMAGE "/usr/share/ibus-dkst/hanja.dict"
+#endif
+#ifndef HANJA_SYSTEM_TEXT
+#define HANJA_SYSTEM_TEXT "/usr/share/ibus-dkst/hanja.txt"
+#endif
+
+const char *hanja_dict_system_path(void) {
+  GStatBuf image_st, text_st;
+  if (g_stat(HANJA_SYSTEM_IMAGE, &image_st) != 0)
+    return HANJA_SYSTEM_TEXT;
+  if (g_stat(HANJA_SYSTEM_TEXT, &text_st) == 0 &&
+      text_st.st_mtime > image_st.st_mtime)
+    return HANJA_SYSTEM_TEXT;
+  return HANJA_SYSTEM_IMAGE;
+}
 
-  GPtrArray *result = g_ptr_array_new_with_free_func(g_free);
+gchar *hanja_dict_user_path(void) {
+  return g_build_filename(g_get_user_config_dir(), "ibus-dkst",
+                          "hanja_user.txt", NULL);
+}
 
-  // First check user dictionary (higher priority)
-  GPtrArray *user_candidates =
-      (GPtrArray *)g_hash_table_lookup(dict->user_dict, hangul);
-  if (user_candidates) {
-    for (guint i = 0; i < user_candidates->len; i++) {
-      g_ptr_array_add(result,
-                      g_strdup((char *)g_ptr_array_index(user_candidates, i)));
-    }
-  }
+HanjaDict *hanja_dict_new_with_user(const HanjaDict *base,
+                                    const char *user_path) {
+  HanjaDict *dict = g_new0(HanjaDict, 1);
+  dict->ref_count = 1;
+  dict->system = table_ref(base->system);
+  dict->user = table_new();
 
-  // Then check system dictionary
-  GPtrArray *sys_candidates =
-      (GPtrArray *)g_hash_table_lookup(dict->system_dict, hangul);
-  if (sys_candidates) {
-    for (guint i = 0; i < sys_candidates->len; i++) {
-      g_ptr_array_add(result,
-                      g_strdup((char *)g_ptr_array_index(sys_candidates, i)));
-    }
+  if (user_path) {
+    load_dict_file(dict->user, user_path);
   }
 
-  // Add original hangul as last option
-  g_ptr_array_add(result, g_strdup(hangul));
+  return dict;
+}
 
-  if (result->len == 1) {
-    // Only has the original hangul, no real candidates found
-    // Still return it so user sees feedback
-  }
+HanjaDict *hanja_dict_ref(HanjaDict *dict) {
+  g_atomic_int_inc(&dict->ref_count);
+  return dict;
+}
 
-  return result;
+void hanja_dict_unref(HanjaDict *dict) {
+  if (!dict || !g_atomic_int_dec_and_test(&dict->ref_count))
+    return;
+
+  table_unref(dict->system);
+  table_unref(dict->user);
+  g_free(dict);
 }
 
-void hanja_dict_free(HanjaDict *dict) {
+static void table_add_info(const HanjaTable *table, HanjaDictInfo *info) {
+  if (!table->data)
+    return;
+  const HanjaImageHeader *hdr = table_header(table);
+  info->n_keys += GUINT32_FROM_LE(hdr->n_keys);
+  info->n_candidates += GUINT32_FROM_LE(hdr->n_candidates);
+  if (table->mapped)
+    info->mapped_bytes += table->size;
+  else
+    info->heap_bytes += table->size;
+}
+
+void hanja_dict_get_info(const HanjaDict *dict, HanjaDictInfo *info) {
+  memset(info, 0, sizeof(*info));
   if (!dict)
     return;
+  table_add_info(dict->system, info);
+  table_add_info(dict->user, info);
+}
 
-  if (dict->system_dict) {
-    g_hash_table_destroy(dict->system_dict);
-    dict->system_dict = NULL;
-  }
+bool hanja_dict_lookup(const HanjaDict *dict, const char *hangul,
+                       HanjaCandidates *out) {
+  if (!out)
+    return false;
+  memset(out, 0, sizeof(*out));
+  if (!dict || !hangul || !*hangul)
+    return false;
+
+  out->dict = dict;
+  out->hangul = hangul;
+
+  // First check user dictionary (higher priority), then system dictionary
+  table_find(dict->user, hangul, &out->user_first, &out->n_user);
+  table_find(dict->system, hangul, &out->system_first, &out->n_system);
+
+  return out->n_user + out->n_system > 0;
+}
+
+guint hanja_dict_lookup_suffixes(const HanjaDict *dict, const char *text,
+                                 gssize len, HanjaCandidates *out,
+                                 guint max_views) {
+  if (!dict || !text || !out || max_views == 0)
+    return 0;
+  const char *end = text + (len < 0 ? strlen(text) : (gsize)len);
+
+  // Matches come back shortest first
+  SuffixMatch user[HANJA_MAX_SUFFIX_MATCHES];
+  SuffixMatch system[HANJA_MAX_SUFFIX_MATCHES];
+  guint n_user = table_match_suffixes(dict->user, text, end, user,
+                                      HANJA_MAX_SUFFIX_MATCHES);
+  guint n_system = table_match_suffixes(dict->system, text, end, system,
+                                        HANJA_MAX_SUFFIX_MATCHES);
+
+  // Merge both lists longest first; a suffix found in both dictionaries
+  // becomes one view with user candidates ahead of system ones
+  guint n = 0;
+  while (n < max_views && (n_user > 0 || n_system > 0)) {
+    if (n > 0 && n + 1 == max_views && n_user + n_system > 1) {
+      // The last view goes to the shortest match left, skipping the rest
+      const char *shortest = n_user > 0 ? user[0].start : system[0].start;
+      if (n_system > 0 && system[0].start > shortest)
+        shortest = system[0].start;
+      n_user = n_user > 0 && user[0].start == shortest;
+      n_system = n_system > 0 && system[0].start == shortest;
+    }
 
-  if (dict->user_dict) {
-    g_hash_table_destroy(dict->user_dict);
-    dict->user_dict = NULL;
+    const char *start;
+    if (n_system == 0 ||
+        (n_user > 0 && user[n_user - 1].start <= system[n_system - 1].start))
+      start = user[n_user - 1].start;
+    else
+      start = system[n_system - 1].start;
+
+    HanjaCandidates *view = &out[n++];
+    memset(view, 0, sizeof(*view));
+    view->dict = dict;
+    view->hangul = start;
+
+    if (n_user > 0 && user[n_user - 1].start == start) {
+      table_key_run(dict->user, user[n_user - 1].key, &view->user_first,
+                    &view->n_user);
+      n_user--;
+    }
+    if (n_system > 0 && system[n_system - 1].start == start) {
+      table_key_run(dict->system, system[n_system - 1].key,
+                    &view->system_first, &view->n_system);
+      n_system--;
+    }
   }
+  return n;
 }
 
-bool hanja_dict_reload_user(HanjaDict *dict, const char *user_path) {
-  if (!dict)
+guint hanja_candidates_count(const HanjaCandidates *cands) {
+  if (!cands || !cands->hangul)
+    return 0;
+  // Original hangul is always offered as the last option
+  return cands->n_user + cands->n_system + 1;
+}
+
+// Resolve a view index to a table and candidate; false for the trailing
+// original hangul (or out of range, with *table left NULL)
+static bool candidate_at(const HanjaCandidates *cands, guint index,
+                         const HanjaTable **table, guint32 *cand) {
+  *table = NULL;
+  if (!cands || !cands->dict)
     return false;
 
-  // Clear and reload user dictionary
-  if (dict->user_dict) {
-    g_hash_table_remove_all(dict->user_dict);
-  } else {
-    dict->user_dict =
-        g_hash_table_new_full(g_str_hash, g_str_equal, g_free, free_candidates);
+  if (index < cands->n_user) {
+    *table = cands->dict->user;
+    *cand = cands->user_first + index;
+    return true;
   }
+  index -= cands->n_user;
 
-  if (user_path) {
-    return load_dict_file(dict->user_dict, user_path);
+  if (index < cands->n_system) {
+    *table = cands->dict->system;
+    *cand = cands->system_first + index;
+    return true;
   }
+  return false;
+}
 
-  return true;
+const char *hanja_candidates_get(const HanjaCandidates *cands, guint index) {
+  const HanjaTable *table;
+  guint32 cand;
+  if (candidate_at(cands, index, &table, &cand))
+    return table_string(
+        table, table_u32(table, table_header(table)->cand_text_offset, cand));
+
+  // The original hangul follows the dictionary candidates
+  if (cands && cands->dict && index == cands->n_user + cands->n_system)
+    return cands->hangul;
+  return NULL;
+}
+
+const char *hanja_candidates_get_note(const HanjaCandidates *cands,
+                                      guint index) {
+  const HanjaTable *table;
+  guint32 cand;
+  if (!candidate_at(cands, index, &table, &cand))
+    return "";
+  return table_string(
+      table, table_u32(table, table_header(table)->cand_note_offset, cand));
+}
+
+bool hanja_dict_compile(const char *text_path, const char *image_path) {
+  if (!text_path || !image_path)
+    return false;
+
+  GByteArray *table = build_table_from_file(text_path);
+  if (!table)
+    return false;
+
+  // g_file_set_contents() writes a temporary file and renames it, so a
+  // running engine keeps its mapping of the old image intact.
+  bool ok = g_file_set_contents(image_path, (const gchar *)table->data,
+                                table->len, NULL);
+  dkst_trace(DKST_TRACE_DICT_IMAGE_WRITTEN, table->len, ok, 0);
+
+  g_byte_array_unref(table);
+  return ok;
 }
@@ -1,31 +1,111 @@
-
 #ifndef HANJA_DICT_H
 #define HANJA_DICT_H
 
 #include <glib.h>
 #include <stdbool.h>
 
-// Hanja dictionary structure
+// One dictionary in the compiled table layout (see hanja_dict.c), backed
+// either by a mapped image file or by a heap arena built from a text file.
+// Immutable once loaded; refcounted so snapshots can share it.
+typedef struct {
+  gint ref_count;
+  GMappedFile *mapped; // Mapped image file (read-only), or NULL
+  guint8 *arena;       // Arena built from a text file, or NULL
+  const char *data;    // Validated table, NULL if nothing is loaded
+  gsize size;
+} HanjaTable;
+
+// Immutable, refcounted snapshot of the system and user dictionaries.
+// A snapshot never changes after it is built: reloading the user dictionary
+// builds a new snapshot that shares the system table with the old one, so
+// readers holding a reference are never disturbed.
 typedef struct {
-  GHashTable *system_dict; // System dictionary (read-only)
-  GHashTable *user_dict;   // User dictionary (editable)
+  gint ref_count;
+  HanjaTable *system; // System dictionary (read-only)
+  HanjaTable *user;   // User dictionary (editable)
 } HanjaDict;
 
-// Initialize and load dictionaries
-// system_path: /usr/share/ibus-dkst/hanja.txt
+// Borrowed view over the candidates of one key. Candidate strings are owned
+// by the dictionary snapshot and stay valid while the caller holds a
+// reference to it; the original hangul is borrowed from the caller of
+// hanja_dict_lookup() and must outlive the view.
+typedef struct {
+  const HanjaDict *dict;
+  guint32 user_first;   // Candidate run in the user table
+  guint32 n_user;
+  guint32 system_first; // Candidate run in the system table
+  guint32 n_system;
+  const char *hangul;   // Original hangul, offered as the last option
+} HanjaCandidates;
+
+// Load a dictionary snapshot (missing files load as empty dictionaries)
+// system_path: /usr/share/ibus-dkst/hanja.dict (compiled image) or
+//              /usr/share/ibus-dkst/hanja.txt (text, parsed at startup)
 // user_path: ~/.config/ibus-dkst/hanja_user.txt
-bool hanja_dict_init(HanjaDict *dict, const char *system_path,
-                     const char *user_path);
+HanjaDict *hanja_dict_new(const char *system_path, const char *user_path);
+
+// The system dictionary dkst-ime loads: the compiled image, unless the text
+// dictionary was edited after it was built (the image would be stale)
+const char *hanja_dict_system_path(void);
+
+// The user's dictionary, ~/.config/ibus-dkst/hanja_user.txt (g_free() it)
+gchar *hanja_dict_user_path(void);
+
+// Build a snapshot with a freshly loaded user dictionary, sharing the
+// system dictionary of base (after the user edited hanja_user.txt)
+HanjaDict *hanja_dict_new_with_user(const HanjaDict *base,
+                                    const char *user_path);
+
+HanjaDict *hanja_dict_ref(HanjaDict *dict);
+void hanja_dict_unref(HanjaDict *dict);
+
+// Size of a snapshot, system and user dictionaries together
+typedef struct {
+  guint n_keys;       // Hangul keys
+  guint n_candidates; // Hanja candidates
+  gsize mapped_bytes; // Tables mapped from image files (page cache)
+  gsize heap_bytes;   // Tables built on the heap from text files
+} HanjaDictInfo;
+
+void hanja_dict_get_info(const HanjaDict *dict, HanjaDictInfo *info);
+
+// Lookup hanja candidates for a hangul string without copying them.
+// Fills *out (user candidates first, then system, then the original hangul)
+// and returns true if the dictionaries had any entry for it.
+bool hanja_dict_lookup(const HanjaDict *dict, const char *hangul,
+                       HanjaCandidates *out);
+
+// Most suffix matches kept per dictionary (the shortest and the longest
+// others)
+#define HANJA_MAX_SUFFIX_MATCHES 32
+
+// Find every dictionary entry that is a suffix of text (e.g. "대한민국" and
+// "국" in "우리대한민국") with one backward walk over each dictionary's
+// reversed-key trie. text is len bytes long, or NUL-terminated if len is
+// negative. Fills out[] with candidate views, longest suffix first; each
+// view's hangul points into text where its suffix starts (and, when len is
+// given, is not NUL-terminated at the end of the suffix). With more
+// suffixes than max_views, the longest max_views - 1 and the shortest are
+// kept, so the last character's own entry is still offered (a single view
+// gets the longest).
+// Returns the number of views filled (at most max_views).
+guint hanja_dict_lookup_suffixes(const HanjaDict *dict, const char *text,
+                                 gssize len, HanjaCandidates *out,
+                                 guint max_views);
+
+// Number of entries in a candidate view, including the original hangul
+guint hanja_candidates_count(const HanjaCandidates *cands);
 
-// Lookup hanja candidates for a hangul string
-// Returns GPtrArray of strings (caller must free with g_ptr_array_unref)
-// Returns NULL if not found
-GPtrArray *hanja_dict_lookup(HanjaDict *dict, const char *hangul);
+// Borrowed commit text of a candidate ("韓" for "韓 (한국 한)"), or NULL if
+// out of range
+const char *hanja_candidates_get(const HanjaCandidates *cands, guint index);
 
-// Free dictionary resources
-void hanja_dict_free(HanjaDict *dict);
+// Borrowed annotation of a candidate ("(한국 한)"), "" if it has none
+const char *hanja_candidates_get_note(const HanjaCandidates *cands,
+                                      guint index);
 
-// Reload user dictionary (after editing)
-bool hanja_dict_reload_user(HanjaDict *dict, const char *user_path);
+// Compile a text dictionary into the binary image format that
+// hanja_dict_new() maps directly (used by dkst-dictc at build time)
+bool hanja_dict_compile(const char *text_path, const char *image_path);
 
 #endif
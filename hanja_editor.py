@@ -118,8 +118,11 @@ class HanjaEditorWindow(Gtk.Window):
         if not os.path.exists(USER_CONFIG_DIR):
             os.makedirs(USER_CONFIG_DIR)
 
+        # Write a temporary file and rename it over the dictionary, so the
+        # input method (which watches the file) never reads a partial save
+        tmp_file = USER_DICT_FILE + ".tmp"
         try:
-            with open(USER_DICT_FILE, "w", encoding="utf-8") as f:
+            with open(tmp_file, "w", encoding="utf-8") as f:
                 f.write("# DKST User Hanja Dictionary\n")
                 f.write("# Format: hangul:hanja1 (meaning),hanja2 (meaning),...\n\n")
                 for row in self.store:
@@ -127,9 +130,15 @@ class HanjaEditorWindow(Gtk.Window):
                     values = row[1].strip()
                     if key and values:
                         f.write(f"{key}:{values}\n")
+            os.replace(tmp_file, USER_DICT_FILE)
             return True
         except Exception as e:
             print(f"Error saving dictionary: {e}")
+            # Don't leave a partial save behind
+            try:
+                os.remove(tmp_file)
+            except OSError:
+                pass
             return False
 
     def on_key_edited(self, widget, path, new_text):
@@ -152,13 +161,7 @@ class HanjaEditorWindow(Gtk.Window):
 
     def on_save_clicked(self, widget):
         if self.save_dictionary():
-            # Restart IBus to reload dictionary
-            import subprocess
-            try:
-                subprocess.run(["ibus", "restart"], check=False)
-            except Exception:
-                pass  # Ignore errors
-            
+            # The input method reloads the user dictionary when it changes
             dialog = Gtk.MessageDialog(
                 transient_for=self,
                 flags=0,
@@ -167,7 +170,7 @@ class HanjaEditorWindow(Gtk.Window):
                 text="저장 완료",
             )
             dialog.format_secondary_text(
-                "사전이 저장되고 입력기가 재시작되었습니다."
+                "사전이 저장되었습니다. 바로 적용됩니다."
             )
             dialog.run()
             dialog.destroy()
@@ -0,0 +1,261 @@
+// Stand-in for <ibus.h> used by the headless harness (bench_engine.c).
+// Declares the part of the IBus API that engine.c uses; ibus_mock.c
+// implements it by recording what the engine sends to the client instead
+// of talking to ibus-daemon. Values match the real IBus headers, and the
+// functions keep the checks and edge cases of libibus-1.0 (ibus_mock.c).
+#ifndef DKST_HEADLESS_IBUS_H
+#define DKST_HEADLESS_IBUS_H
+
+#include <gio/gio.h>
+#include <glib-object.h>
+
+// --- Key symbols (ibuskeysyms.h) ---
+#define IBUS_KEY_space 0x020
+#define IBUS_KEY_1 0x031
+#define IBUS_KEY_2 0x032
+#define IBUS_KEY_3 0x033
+#define IBUS_KEY_4 0x034
+#define IBUS_KEY_5 0x035
+#define IBUS_KEY_6 0x036
+#define IBUS_KEY_7 0x037
+#define IBUS_KEY_8 0x038
+#define IBUS_KEY_9 0x039
+#define IBUS_KEY_BackSpace 0xff08
+#define IBUS_KEY_Tab 0xff09
+#define IBUS_KEY_Return 0xff0d
+#define IBUS_KEY_Escape 0xff1b
+#define IBUS_KEY_Hangul 0xff31
+#define IBUS_KEY_Hangul_Hanja 0xff34
+#define IBUS_KEY_Left 0xff51
+#define IBUS_KEY_Up 0xff52
+#define IBUS_KEY_Right 0xff53
+#define IBUS_KEY_Down 0xff54
+#define IBUS_KEY_Page_Up 0xff55
+#define IBUS_KEY_Page_Down 0xff56
+#define IBUS_KEY_KP_Enter 0xff8d
+#define IBUS_KEY_KP_Up 0xff97
+#define IBUS_KEY_KP_Down 0xff99
+#define IBUS_KEY_Shift_L 0xffe1
+#define IBUS_KEY_Shift_R 0xffe2
+#define IBUS_KEY_Control_L 0xffe3
+#define IBUS_KEY_Control_R 0xffe4
+#define IBUS_KEY_Caps_Lock 0xffe5
+#define IBUS_KEY_Meta_L 0xffe7
+#define IBUS_KEY_Meta_R 0xffe8
+#define IBUS_KEY_Alt_L 0xffe9
+#define IBUS_KEY_Alt_R 0xffea
+#define IBUS_KEY_Super_L 0xffeb
+#define IBUS_KEY_Super_R 0xffec
+#define IBUS_KEY_VoidSymbol 0xffffff
+
+typedef enum {
+  IBUS_SHIFT_MASK = 1 << 0,
+  IBUS_LOCK_MASK = 1 << 1,
+  IBUS_CONTROL_MASK = 1 << 2,
+  IBUS_MOD1_MASK = 1 << 3,
+  IBUS_SUPER_MASK = 1 << 26,
+  IBUS_HYPER_MASK = 1 << 27,
+  IBUS_META_MASK = 1 << 28,
+  IBUS_RELEASE_MASK = 1 << 30,
+} IBusModifierType;
+
+typedef enum {
+  IBUS_CAP_PREEDIT_TEXT = 1 << 0,
+  IBUS_CAP_AUXILIARY_TEXT = 1 << 1,
+  IBUS_CAP_LOOKUP_TABLE = 1 << 2,
+  IBUS_CAP_FOCUS = 1 << 3,
+  IBUS_CAP_PROPERTY = 1 << 4,
+  IBUS_CAP_SURROUNDING_TEXT = 1 << 5,
+} IBusCapabilite;
+
+typedef enum {
+  IBUS_ENGINE_PREEDIT_CLEAR = 0,
+  IBUS_ENGINE_PREEDIT_COMMIT = 1,
+} IBusPreeditFocusMode;
+
+typedef enum {
+  IBUS_ATTR_TYPE_UNDERLINE = 1,
+  IBUS_ATTR_TYPE_FOREGROUND = 2,
+  IBUS_ATTR_TYPE_BACKGROUND = 3,
+} IBusAttrType;
+
+typedef enum {
+  IBUS_ATTR_UNDERLINE_NONE = 0,
+  IBUS_ATTR_UNDERLINE_SINGLE = 1,
+} IBusAttrUnderline;
+
+typedef enum { PROP_TYPE_NORMAL = 0 } IBusPropType;
+typedef enum { PROP_STATE_UNCHECKED = 0 } IBusPropState;
+
+// --- Objects ---
+// Floating like their IBus counterparts: whoever receives one sinks it.
+
+typedef struct {
+  guint type;
+  guint value;
+  guint start_index;
+  guint end_index;
+} IBusAttribute;
+
+typedef struct {
+  GInitiallyUnowned parent;
+  GArray *attributes; // IBusAttribute
+} IBusAttrList;
+
+typedef struct {
+  GInitiallyUnowned parent;
+  gboolean is_static; // text is borrowed, not freed with the object
+  gchar *text;
+  IBusAttrList *attrs; // NULL until attributes are set
+} IBusText;
+
+typedef struct {
+  GInitiallyUnowned parent;
+  guint page_size;
+  guint cursor_pos;
+  gboolean round;
+  GPtrArray *candidates; // IBusText
+} IBusLookupTable;
+
+typedef struct {
+  GInitiallyUnowned parent;
+  gchar *key;
+  gchar *icon;
+  IBusText *label;
+  IBusText *symbol; // NULL until set
+  IBusText *tooltip;
+  struct _IBusPropList *sub_props;
+} IBusProperty;
+
+typedef struct _IBusPropList {
+  GInitiallyUnowned parent;
+  GPtrArray *properties; // IBusProperty
+} IBusPropList;
+
+typedef struct {
+  GInitiallyUnowned parent;
+  guint client_capabilities;
+} IBusEngine;
+
+typedef struct {
+  GInitiallyUnownedClass parent;
+  gboolean (*process_key_event)(IBusEngine *engine, guint keyval,
+                                guint keycode, guint state);
+  void (*focus_in)(IBusEngine *engine);
+  void (*focus_out)(IBusEngine *engine);
+  void (*reset)(IBusEngine *engine);
+  void (*enable)(IBusEngine *engine);
+  void (*disable)(IBusEngine *engine);
+  void (*set_capabilities)(IBusEngine *engine, guint caps);
+  void (*property_activate)(IBusEngine *engine, const gchar *prop_name,
+                            guint prop_state);
+} IBusEngineClass;
+
+typedef struct {
+  GInitiallyUnownedClass parent;
+} IBusTextClass, IBusAttrListClass, IBusLookupTableClass, IBusPropertyClass,
+    IBusPropListClass;
+
+GType ibus_text_get_type(void);
+GType ibus_attr_list_get_type(void);
+GType ibus_property_get_type(void);
+GType ibus_prop_list_get_type(void);
+GType ibus_engine_get_type(void);
+#define IBUS_TYPE_ENGINE (ibus_engine_get_type())
+#define IBUS_ENGINE_CLASS(klass)                                               \
+  (G_TYPE_CHECK_CLASS_CAST((klass), IBUS_TYPE_ENGINE, IBusEngineClass))
+#define IBUS_ENGINE_GET_CLASS(obj)                                             \
+  (G_TYPE_INSTANCE_GET_CLASS((obj), IBUS_TYPE_ENGINE, IBusEngineClass))
+
+GType ibus_lookup_table_get_type(void);
+#define IBUS_IS_TEXT(obj)                                                      \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj), ibus_text_get_type()))
+#define IBUS_IS_ATTR_LIST(obj)                                                 \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj), ibus_attr_list_get_type()))
+#define IBUS_IS_LOOKUP_TABLE(obj)                                              \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj), ibus_lookup_table_get_type()))
+#define IBUS_IS_PROPERTY(obj)                                                  \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj), ibus_property_get_type()))
+#define IBUS_IS_PROP_LIST(obj)                                                 \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj), ibus_prop_list_get_type()))
+
+// --- Text ---
+IBusText *ibus_text_new_from_string(const gchar *str);
+IBusText *ibus_text_new_from_static_string(const gchar *str);
+guint ibus_text_get_length(IBusText *text);
+IBusAttrList *ibus_text_get_attributes(IBusText *text);
+void ibus_text_set_attributes(IBusText *text, IBusAttrList *attrs);
+void ibus_text_append_attribute(IBusText *text, guint type, guint value,
+                                guint start_index, gint end_index);
+IBusAttrList *ibus_attr_list_new(void);
+IBusAttribute *ibus_attr_list_get(IBusAttrList *attr_list, guint index);
+
+// --- Lookup table ---
+IBusLookupTable *ibus_lookup_table_new(guint page_size, guint cursor_pos,
+                                       gboolean cursor_visible,
+                                       gboolean round);
+void ibus_lookup_table_clear(IBusLookupTable *table);
+void ibus_lookup_table_append_candidate(IBusLookupTable *table,
+                                        IBusText *text);
+void ibus_lookup_table_set_cursor_pos(IBusLookupTable *table,
+                                      guint cursor_pos);
+guint ibus_lookup_table_get_page_size(IBusLookupTable *table);
+
+// --- Properties ---
+IBusProperty *ibus_property_new(const gchar *key, IBusPropType type,
+                                IBusText *label, const gchar *icon,
+                                IBusText *tooltip, gboolean sensitive,
+                                gboolean visible, IBusPropState state,
+                                IBusPropList *prop_list);
+void ibus_property_set_symbol(IBusProperty *prop, IBusText *symbol);
+void ibus_property_set_icon(IBusProperty *prop, const gchar *icon);
+void ibus_property_set_label(IBusProperty *prop, IBusText *label);
+void ibus_property_set_tooltip(IBusProperty *prop, IBusText *tooltip);
+IBusPropList *ibus_prop_list_new(void);
+void ibus_prop_list_append(IBusPropList *prop_list, IBusProperty *prop);
+
+// --- Engine to client ---
+void ibus_engine_commit_text(IBusEngine *engine, IBusText *text);
+void ibus_engine_update_preedit_text_with_mode(IBusEngine *engine,
+                                               IBusText *text,
+                                               guint cursor_pos,
+                                               gboolean visible,
+                                               IBusPreeditFocusMode mode);
+void ibus_engine_hide_preedit_text(IBusEngine *engine);
+void ibus_engine_update_auxiliary_text(IBusEngine *engine, IBusText *text,
+                                       gboolean visible);
+void ibus_engine_hide_auxiliary_text(IBusEngine *engine);
+void ibus_engine_update_lookup_table(IBusEngine *engine,
+                                     IBusLookupTable *table,
+                                     gboolean visible);
+void ibus_engine_hide_lookup_table(IBusEngine *engine);
+void ibus_engine_delete_surrounding_text(IBusEngine *engine, gint offset,
+                                         guint nchars);
+void ibus_engine_register_properties(IBusEngine *engine,
+                                     IBusPropList *prop_list);
+void ibus_engine_update_property(IBusEngine *engine, IBusProperty *prop);
+
+// --- Key names ---
+guint ibus_keyval_from_name(const gchar *name);
+
+// --- What the client saw ---
+typedef struct {
+  GString *committed;      // Text as the application has it
+  GString *preedit;        // Preedit currently shown ("" if hidden)
+  GString *auxiliary;      // Auxiliary text currently shown ("" if hidden)
+  guint n_commits;         // ibus_engine_commit_text() calls
+  guint n_preedit;         // Preedit updates (including hides)
+  guint n_lookup_table;    // Lookup table updates (including hides)
+  guint n_auxiliary;       // Auxiliary text updates (including hides)
+  guint n_delete_surrounding;
+  guint n_property;        // Property registrations and updates
+  gboolean lookup_table_visible;
+  guint n_candidates;      // Candidates in the last lookup table shown
+  guint n_candidates_sent; // Candidates in all lookup tables shown
+} HeadlessSink;
+
+extern HeadlessSink headless_sink;
+
+void headless_sink_reset(void);
+
+#endif
@@ -0,0 +1,464 @@
+// Recording implementation of headless/ibus.h: engine-to-client calls
+// update headless_sink instead of going over D-Bus, so the engine can be
+// driven and checked without ibus-daemon.
+//
+// Everything else follows libibus-1.0, including what it rejects: a call
+// libibus would g_assert() on aborts here too, and one it would refuse
+// with g_return_if_fail() is a critical, which bench_engine makes fatal.
+// When adding a stub, copy those checks from the libibus source.
+
+#include "ibus.h"
+#include <string.h>
+
+HeadlessSink headless_sink;
+
+// Strings are emptied but keep their memory, so a replay after the first
+// does not grow them again (bench_engine counts heap calls)
+void headless_sink_reset(void) {
+  GString *committed = headless_sink.committed;
+  GString *preedit = headless_sink.preedit;
+  GString *auxiliary = headless_sink.auxiliary;
+  memset(&headless_sink, 0, sizeof(headless_sink));
+  headless_sink.committed =
+      committed ? g_string_truncate(committed, 0) : g_string_new("");
+  headless_sink.preedit =
+      preedit ? g_string_truncate(preedit, 0) : g_string_new("");
+  headless_sink.auxiliary =
+      auxiliary ? g_string_truncate(auxiliary, 0) : g_string_new("");
+}
+
+// Take ownership of an object the engine handed over floating
+static void consume(gpointer object) {
+  if (object) {
+    g_object_ref_sink(object);
+    g_object_unref(object);
+  }
+}
+
+// --- Objects ---
+
+G_DEFINE_TYPE(IBusText, ibus_text, G_TYPE_INITIALLY_UNOWNED)
+
+static void ibus_text_finalize(GObject *object) {
+  IBusText *text = (IBusText *)object;
+  if (!text->is_static)
+    g_free(text->text);
+  if (text->attrs)
+    g_object_unref(text->attrs);
+  G_OBJECT_CLASS(ibus_text_parent_class)->finalize(object);
+}
+
+static void ibus_text_class_init(IBusTextClass *klass) {
+  G_OBJECT_CLASS(klass)->finalize = ibus_text_finalize;
+}
+
+static void ibus_text_init(IBusText *text) { (void)text; }
+
+G_DEFINE_TYPE(IBusAttrList, ibus_attr_list, G_TYPE_INITIALLY_UNOWNED)
+
+static void ibus_attr_list_finalize(GObject *object) {
+  g_array_unref(((IBusAttrList *)object)->attributes);
+  G_OBJECT_CLASS(ibus_attr_list_parent_class)->finalize(object);
+}
+
+static void ibus_attr_list_class_init(IBusAttrListClass *klass) {
+  G_OBJECT_CLASS(klass)->finalize = ibus_attr_list_finalize;
+}
+
+static void ibus_attr_list_init(IBusAttrList *attrs) {
+  attrs->attributes = g_array_new(FALSE, FALSE, sizeof(IBusAttribute));
+}
+
+G_DEFINE_TYPE(IBusLookupTable, ibus_lookup_table, G_TYPE_INITIALLY_UNOWNED)
+
+static void ibus_lookup_table_finalize(GObject *object) {
+  g_ptr_array_unref(((IBusLookupTable *)object)->candidates);
+  G_OBJECT_CLASS(ibus_lookup_table_parent_class)->finalize(object);
+}
+
+static void ibus_lookup_table_class_init(IBusLookupTableClass *klass) {
+  G_OBJECT_CLASS(klass)->finalize = ibus_lookup_table_finalize;
+}
+
+static void ibus_lookup_table_init(IBusLookupTable *table) {
+  table->candidates = g_ptr_array_new_with_free_func(g_object_unref);
+}
+
+G_DEFINE_TYPE(IBusProperty, ibus_property, G_TYPE_INITIALLY_UNOWNED)
+
+static void ibus_property_finalize(GObject *object) {
+  IBusProperty *prop = (IBusProperty *)object;
+  g_free(prop->key);
+  g_free(prop->icon);
+  g_clear_object(&prop->label);
+  g_clear_object(&prop->symbol);
+  g_clear_object(&prop->tooltip);
+  g_clear_object(&prop->sub_props);
+  G_OBJECT_CLASS(ibus_property_parent_class)->finalize(object);
+}
+
+static void ibus_property_class_init(IBusPropertyClass *klass) {
+  G_OBJECT_CLASS(klass)->finalize = ibus_property_finalize;
+}
+
+static void ibus_property_init(IBusProperty *prop) { (void)prop; }
+
+G_DEFINE_TYPE(IBusPropList, ibus_prop_list, G_TYPE_INITIALLY_UNOWNED)
+
+static void ibus_prop_list_finalize(GObject *object) {
+  g_ptr_array_unref(((IBusPropList *)object)->properties);
+  G_OBJECT_CLASS(ibus_prop_list_parent_class)->finalize(object);
+}
+
+static void ibus_prop_list_class_init(IBusPropListClass *klass) {
+  G_OBJECT_CLASS(klass)->finalize = ibus_prop_list_finalize;
+}
+
+static void ibus_prop_list_init(IBusPropList *prop_list) {
+  prop_list->properties = g_ptr_array_new_with_free_func(g_object_unref);
+}
+
+G_DEFINE_TYPE(IBusEngine, ibus_engine, G_TYPE_INITIALLY_UNOWNED)
+
+static void ibus_engine_class_init(IBusEngineClass *klass) { (void)klass; }
+
+static void ibus_engine_init(IBusEngine *engine) { (void)engine; }
+
+// --- Text ---
+
+IBusText *ibus_text_new_from_string(const gchar *str) {
+  g_assert(str);
+  IBusText *text = g_object_new(ibus_text_get_type(), NULL);
+  text->text = g_strdup(str);
+  return text;
+}
+
+IBusText *ibus_text_new_from_static_string(const gchar *str) {
+  g_assert(str);
+  IBusText *text = g_object_new(ibus_text_get_type(), NULL);
+  text->is_static = TRUE;
+  text->text = (gchar *)str;
+  return text;
+}
+
+guint ibus_text_get_length(IBusText *text) {
+  g_assert(IBUS_IS_TEXT(text));
+  return g_utf8_strlen(text->text, -1);
+}
+
+// NULL until attributes are set or appended
+IBusAttrList *ibus_text_get_attributes(IBusText *text) {
+  g_assert(IBUS_IS_TEXT(text));
+  return text->attrs;
+}
+
+void ibus_text_set_attributes(IBusText *text, IBusAttrList *attrs) {
+  g_return_if_fail(IBUS_IS_TEXT(text));
+  g_return_if_fail(IBUS_IS_ATTR_LIST(attrs));
+  g_object_ref_sink(attrs);
+  if (text->attrs)
+    g_object_unref(text->attrs);
+  text->attrs = attrs;
+}
+
+// A negative end_index counts back from the end of the text (-1 is the
+// end). Attributes that then end at 0 or before are dropped, and no list
+// is created for them.
+void ibus_text_append_attribute(IBusText *text, guint type, guint value,
+                                guint start_index, gint end_index) {
+  g_assert(IBUS_IS_TEXT(text));
+  if (end_index < 0)
+    end_index += g_utf8_strlen(text->text, -1) + 1;
+  if (end_index <= 0)
+    return;
+  if (!text->attrs)
+    ibus_text_set_attributes(text, ibus_attr_list_new());
+  IBusAttribute attr = {type, value, start_index, end_index};
+  g_array_append_val(text->attrs->attributes, attr);
+}
+
+IBusAttrList *ibus_attr_list_new(void) {
+  return g_object_new(ibus_attr_list_get_type(), NULL);
+}
+
+IBusAttribute *ibus_attr_list_get(IBusAttrList *attr_list, guint index) {
+  g_assert(IBUS_IS_ATTR_LIST(attr_list));
+  if (index >= attr_list->attributes->len)
+    return NULL;
+  return &g_array_index(attr_list->attributes, IBusAttribute, index);
+}
+
+// --- Lookup table ---
+
+IBusLookupTable *ibus_lookup_table_new(guint page_size, guint cursor_pos,
+                                       gboolean cursor_visible,
+                                       gboolean round) {
+  (void)cursor_visible;
+  g_assert(page_size > 0 && page_size <= 16);
+  IBusLookupTable *table = g_object_new(ibus_lookup_table_get_type(), NULL);
+  table->page_size = page_size;
+  table->cursor_pos = cursor_pos;
+  table->round = round;
+  return table;
+}
+
+void ibus_lookup_table_clear(IBusLookupTable *table) {
+  g_assert(IBUS_IS_LOOKUP_TABLE(table));
+  g_ptr_array_set_size(table->candidates, 0);
+  table->cursor_pos = 0;
+}
+
+void ibus_lookup_table_append_candidate(IBusLookupTable *table,
+                                        IBusText *text) {
+  g_assert(IBUS_IS_LOOKUP_TABLE(table));
+  g_assert(IBUS_IS_TEXT(text));
+  g_ptr_array_add(table->candidates, g_object_ref_sink(text));
+}
+
+void ibus_lookup_table_set_cursor_pos(IBusLookupTable *table,
+                                      guint cursor_pos) {
+  g_assert(IBUS_IS_LOOKUP_TABLE(table));
+  g_assert(cursor_pos < table->candidates->len);
+  table->cursor_pos = cursor_pos;
+}
+
+guint ibus_lookup_table_get_page_size(IBusLookupTable *table) {
+  g_assert(IBUS_IS_LOOKUP_TABLE(table));
+  return table->page_size;
+}
+
+// --- Properties ---
+
+// Like libibus, a property keeps the texts and sub-properties it is given
+// (sinking floating ones) until they are replaced or it is finalized
+
+static void set_text(IBusText **field, IBusText *text) {
+  if (text)
+    g_object_ref_sink(text);
+  if (*field)
+    g_object_unref(*field);
+  *field = text;
+}
+
+IBusProperty *ibus_property_new(const gchar *key, IBusPropType type,
+                                IBusText *label, const gchar *icon,
+                                IBusText *tooltip, gboolean sensitive,
+                                gboolean visible, IBusPropState state,
+                                IBusPropList *prop_list) {
+  (void)type, (void)sensitive, (void)visible, (void)state;
+  g_return_val_if_fail(key != NULL, NULL);
+  g_return_val_if_fail(label == NULL || IBUS_IS_TEXT(label), NULL);
+  g_return_val_if_fail(tooltip == NULL || IBUS_IS_TEXT(tooltip), NULL);
+  IBusProperty *prop = g_object_new(ibus_property_get_type(), NULL);
+  prop->key = g_strdup(key);
+  prop->icon = g_strdup(icon ? icon : "");
+  set_text(&prop->label, label ? label : ibus_text_new_from_static_string(""));
+  set_text(&prop->tooltip,
+           tooltip ? tooltip : ibus_text_new_from_static_string(""));
+  prop->sub_props = prop_list ? g_object_ref_sink(prop_list)
+                              : g_object_ref_sink(ibus_prop_list_new());
+  return prop;
+}
+
+void ibus_property_set_symbol(IBusProperty *prop, IBusText *symbol) {
+  g_assert(IBUS_IS_PROPERTY(prop));
+  g_return_if_fail(symbol == NULL || IBUS_IS_TEXT(symbol));
+  set_text(&prop->symbol,
+           symbol ? symbol : ibus_text_new_from_static_string(""));
+}
+
+void ibus_property_set_icon(IBusProperty *prop, const gchar *icon) {
+  g_assert(IBUS_IS_PROPERTY(prop));
+  g_free(prop->icon);
+  prop->icon = g_strdup(icon ? icon : "");
+}
+
+void ibus_property_set_label(IBusProperty *prop, IBusText *label) {
+  g_assert(IBUS_IS_PROPERTY(prop));
+  g_return_if_fail(label == NULL || IBUS_IS_TEXT(label));
+  set_text(&prop->label, label ? label : ibus_text_new_from_static_string(""));
+}
+
+void ibus_property_set_tooltip(IBusProperty *prop, IBusText *tooltip) {
+  g_assert(IBUS_IS_PROPERTY(prop));
+  g_return_if_fail(tooltip == NULL || IBUS_IS_TEXT(tooltip));
+  set_text(&prop->tooltip,
+           tooltip ? tooltip : ibus_text_new_from_static_string(""));
+}
+
+IBusPropList *ibus_prop_list_new(void) {
+  return g_object_new(ibus_prop_list_get_type(), NULL);
+}
+
+void ibus_prop_list_append(IBusPropList *prop_list, IBusProperty *prop) {
+  g_return_if_fail(IBUS_IS_PROP_LIST(prop_list));
+  g_return_if_fail(IBUS_IS_PROPERTY(prop));
+  g_ptr_array_add(prop_list->properties, g_object_ref_sink(prop));
+}
+
+// --- Engine to client ---
+
+void ibus_engine_commit_text(IBusEngine *engine, IBusText *text) {
+  (void)engine;
+  g_return_if_fail(IBUS_IS_TEXT(text));
+  headless_sink.n_commits++;
+  g_string_append(headless_sink.committed, text->text);
+  consume(text);
+}
+
+void ibus_engine_update_preedit_text_with_mode(IBusEngine *engine,
+                                               IBusText *text,
+                                               guint cursor_pos,
+                                               gboolean visible,
+                                               IBusPreeditFocusMode mode) {
+  (void)engine, (void)cursor_pos, (void)mode;
+  g_return_if_fail(IBUS_IS_TEXT(text));
+  headless_sink.n_preedit++;
+  g_string_assign(headless_sink.preedit, visible ? text->text : "");
+  consume(text);
+}
+
+void ibus_engine_hide_preedit_text(IBusEngine *engine) {
+  (void)engine;
+  headless_sink.n_preedit++;
+  g_string_truncate(headless_sink.preedit, 0);
+}
+
+void ibus_engine_update_auxiliary_text(IBusEngine *engine, IBusText *text,
+                                       gboolean visible) {
+  (void)engine;
+  g_return_if_fail(IBUS_IS_TEXT(text));
+  headless_sink.n_auxiliary++;
+  g_string_assign(headless_sink.auxiliary, visible ? text->text : "");
+  consume(text);
+}
+
+void ibus_engine_hide_auxiliary_text(IBusEngine *engine) {
+  (void)engine;
+  headless_sink.n_auxiliary++;
+  g_string_truncate(headless_sink.auxiliary, 0);
+}
+
+void ibus_engine_update_lookup_table(IBusEngine *engine,
+                                     IBusLookupTable *table,
+                                     gboolean visible) {
+  (void)engine;
+  g_return_if_fail(IBUS_IS_LOOKUP_TABLE(table));
+  headless_sink.n_lookup_table++;
+  headless_sink.lookup_table_visible = visible;
+  headless_sink.n_candidates = table->candidates->len;
+  headless_sink.n_candidates_sent += table->candidates->len;
+}
+
+void ibus_engine_hide_lookup_table(IBusEngine *engine) {
+  (void)engine;
+  headless_sink.n_lookup_table++;
+  headless_sink.lookup_table_visible = FALSE;
+}
+
+// Only deletions right before the cursor (the end of the committed text)
+// are needed: that is how the engine replaces a word with its Hanja. A
+// client without surrounding text support ignores them.
+void ibus_engine_delete_surrounding_text(IBusEngine *engine, gint offset,
+                                         guint nchars) {
+  headless_sink.n_delete_surrounding++;
+  if (!(engine->client_capabilities & IBUS_CAP_SURROUNDING_TEXT))
+    return;
+
+  GString *text = headless_sink.committed;
+  glong len = g_utf8_strlen(text->str, text->len);
+  glong start = len + offset;
+  if (offset >= 0 || start < 0)
+    return;
+  glong end = MIN(start + (glong)nchars, len);
+  const gchar *from = g_utf8_offset_to_pointer(text->str, start);
+  const gchar *to = g_utf8_offset_to_pointer(text->str, end);
+  g_string_erase(text, from - text->str, to - from);
+}
+
+void ibus_engine_register_properties(IBusEngine *engine,
+                                     IBusPropList *prop_list) {
+  (void)engine;
+  g_return_if_fail(IBUS_IS_PROP_LIST(prop_list));
+  headless_sink.n_property++;
+}
+
+void ibus_engine_update_property(IBusEngine *engine, IBusProperty *prop) {
+  (void)engine;
+  g_return_if_fail(IBUS_IS_PROPERTY(prop));
+  headless_sink.n_property++;
+}
+
+// --- Key names ---
+
+static const struct {
+  const char *name;
+  guint keyval;
+} key_names[] = {
+    {"space", IBUS_KEY_space},
+    {"exclam", '!'},
+    {"quotedbl", '"'},
+    {"numbersign", '#'},
+    {"dollar", '$'},
+    {"percent", '%'},
+    {"ampersand", '&'},
+    {"apostrophe", '\''},
+    {"parenleft", '('},
+    {"parenright", ')'},
+    {"asterisk", '*'},
+    {"plus", '+'},
+    {"comma", ','},
+    {"minus", '-'},
+    {"period", '.'},
+    {"slash", '/'},
+    {"colon", ':'},
+    {"semicolon", ';'},
+    {"less", '<'},
+    {"equal", '='},
+    {"greater", '>'},
+    {"question", '?'},
+    {"at", '@'},
+    {"bracketleft", '['},
+    {"backslash", '\\'},
+    {"bracketright", ']'},
+    {"asciicircum", '^'},
+    {"underscore", '_'},
+    {"grave", '`'},
+    {"braceleft", '{'},
+    {"bar", '|'},
+    {"braceright", '}'},
+    {"asciitilde", '~'},
+    {"BackSpace", IBUS_KEY_BackSpace},
+    {"Tab", IBUS_KEY_Tab},
+    {"Return", IBUS_KEY_Return},
+    {"Escape", IBUS_KEY_Escape},
+    {"Hangul", IBUS_KEY_Hangul},
+    {"Hangul_Hanja", IBUS_KEY_Hangul_Hanja},
+    {"Left", IBUS_KEY_Left},
+    {"Up", IBUS_KEY_Up},
+    {"Right", IBUS_KEY_Right},
+    {"Down", IBUS_KEY_Down},
+    {"Page_Up", IBUS_KEY_Page_Up},
+    {"Page_Down", IBUS_KEY_Page_Down},
+    {"KP_Enter", IBUS_KEY_KP_Enter},
+    {"Shift_L", IBUS_KEY_Shift_L},
+    {"Shift_R", IBUS_KEY_Shift_R},
+    {"Control_L", IBUS_KEY_Control_L},
+    {"Control_R", IBUS_KEY_Control_R},
+    {"Caps_Lock", IBUS_KEY_Caps_Lock},
+    {"Alt_L", IBUS_KEY_Alt_L},
+    {"Alt_R", IBUS_KEY_Alt_R},
+    {"Super_L", IBUS_KEY_Super_L},
+    {"Super_R", IBUS_KEY_Super_R},
+};
+
+// Letters and digits are their own names, as in X11
+guint ibus_keyval_from_name(const gchar *name) {
+  if (name[0] && !name[1] && g_ascii_isalnum(name[0]))
+    return (guchar)name[0];
+  for (gsize i = 0; i < G_N_ELEMENTS(key_names); i++) {
+    if (strcmp(key_names[i].name, name) == 0)
+      return key_names[i].keyval;
+  }
+  return IBUS_KEY_VoidSymbol;
+}
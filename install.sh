@@ -34,7 +34,7 @@ run_as_user() {
 install_build_dependencies() {
     if ! command -v apt-get >/dev/null 2>&1; then
         echo "Missing build dependencies, and apt-get was not found."
-        echo "Please install: build-essential pkg-config libibus-1.0-dev libglib2.0-dev"
+        echo "Please install: build-essential python3 pkg-config libibus-1.0-dev libglib2.0-dev"
         exit 1
     fi
 
@@ -42,6 +42,7 @@ install_build_dependencies() {
     run_as_root apt-get update
     run_as_root apt-get install -y \
         build-essential \
+        python3 \
         pkg-config \
         libibus-1.0-dev \
         libglib2.0-dev
@@ -60,6 +61,11 @@ check_build_dependencies() {
         missing=1
     fi
 
+    if ! command -v python3 >/dev/null 2>&1; then
+        echo "Missing command: python3"
+        missing=1
+    fi
+
     if ! command -v pkg-config >/dev/null 2>&1; then
         echo "Missing command: pkg-config"
         missing=1
@@ -76,13 +82,13 @@ check_build_dependencies() {
         read -r -p "Install required build packages now? [Y/n] " answer
         case "$answer" in
             [nN]|[nN][oO])
-                echo "Aborted. Please install: build-essential pkg-config libibus-1.0-dev libglib2.0-dev"
+                echo "Aborted. Please install: build-essential python3 pkg-config libibus-1.0-dev libglib2.0-dev"
                 exit 1
                 ;;
         esac
         install_build_dependencies
     else
-        echo "Please install: build-essential pkg-config libibus-1.0-dev libglib2.0-dev"
+        echo "Please install: build-essential python3 pkg-config libibus-1.0-dev libglib2.0-dev"
         exit 1
     fi
 }
@@ -106,6 +112,7 @@ run_as_root install -m 755 dkst-ime "$DEST_DIR/dkst-ime"
 run_as_root install -m 755 setup.py "$DEST_DIR/setup.py"
 run_as_root install -m 755 hanja_editor.py "$DEST_DIR/hanja_editor.py"
 run_as_root install -m 644 hanja.txt "$DEST_DIR/hanja.txt"
+run_as_root install -m 644 hanja.dict "$DEST_DIR/hanja.dict"
 run_as_root install -m 644 icon.png "$DEST_DIR/icon.png"
 
 run_as_root install -m 644 config.ini "$DEST_DIR/config.ini"
@@ -0,0 +1,124 @@
+#include "latency.h"
+#include <string.h>
+
+#ifndef DKST_NO_LATENCY
+
+// Bucket i < 4 holds exactly i ns. Above that, each power of two [2^m,
+// 2^(m+1)) is split into four buckets by the two bits below the top one.
+// Anything from 2^37 ns (about two minutes) up lands in the last bucket.
+#define SUB_BITS 2
+#define MAX_BIT 36
+#define N_BUCKETS ((MAX_BIT - SUB_BITS + 2) << SUB_BITS)
+
+typedef struct {
+  guint64 count;
+  guint64 sum_ns;
+  guint64 max_ns;
+  guint64 buckets[N_BUCKETS];
+} Histogram;
+
+static const char *class_names[DKST_LATENCY_N_CLASSES] = {
+    "compose",          "commit",           "hanja-open",
+    "candidate-move",   "candidate-select", "other",
+};
+
+static Histogram histograms[DKST_LATENCY_N_CLASSES];
+
+static guint bucket_of(guint64 ns) {
+  if (ns < (1u << SUB_BITS))
+    return ns;
+  guint msb = 63 - __builtin_clzll(ns);
+  if (msb > MAX_BIT)
+    return N_BUCKETS - 1;
+  guint sub = (ns >> (msb - SUB_BITS)) & ((1u << SUB_BITS) - 1);
+  return ((msb - SUB_BITS + 1) << SUB_BITS) + sub;
+}
+
+void dkst_latency_record(DkstLatencyClass cls, gint64 ns) {
+  Histogram *h = &histograms[cls];
+  if (ns < 0)
+    ns = 0;
+  h->count++;
+  h->sum_ns += ns;
+  if ((guint64)ns > h->max_ns)
+    h->max_ns = ns;
+  h->buckets[bucket_of(ns)]++;
+}
+
+// Smallest value that falls into bucket i
+static guint64 bucket_floor(guint i) {
+  if (i < (1u << SUB_BITS))
+    return i;
+  guint msb = (i >> SUB_BITS) + SUB_BITS - 1;
+  guint64 sub = i & ((1u << SUB_BITS) - 1);
+  return ((1ull << SUB_BITS) | sub) << (msb - SUB_BITS);
+}
+
+// Upper bound of the bucket holding the p-th percentile
+static guint64 percentile(const Histogram *h, double p) {
+  guint64 rank = (guint64)(p / 100.0 * h->count + 0.5);
+  guint64 seen = 0;
+  if (rank == 0)
+    rank = 1;
+  for (guint i = 0; i < N_BUCKETS; i++) {
+    seen += h->buckets[i];
+    if (seen >= rank && i + 1 < N_BUCKETS)
+      return MIN(bucket_floor(i + 1) - 1, h->max_ns);
+  }
+  return h->max_ns;
+}
+
+gboolean dkst_latency_dump(const char *path, GError **error) {
+  GString *out = g_string_new("");
+
+  g_string_append(out, "# dkst-ime key press latency in ns, by what the key "
+                       "did (percentiles are bucket upper bounds)\n");
+  g_string_append_printf(out, "%-17s %10s %9s %9s %9s %9s %9s %9s\n", "class",
+                         "count", "mean", "p50", "p90", "p99", "p99.9",
+                         "max");
+  for (guint c = 0; c < DKST_LATENCY_N_CLASSES; c++) {
+    const Histogram *h = &histograms[c];
+    if (h->count == 0) {
+      g_string_append_printf(out, "%-17s %10d\n", class_names[c], 0);
+      continue;
+    }
+    g_string_append_printf(
+        out,
+        "%-17s %10" G_GUINT64_FORMAT " %9" G_GUINT64_FORMAT
+        " %9" G_GUINT64_FORMAT " %9" G_GUINT64_FORMAT " %9" G_GUINT64_FORMAT
+        " %9" G_GUINT64_FORMAT " %9" G_GUINT64_FORMAT "\n",
+        class_names[c], h->count, h->sum_ns / h->count, percentile(h, 50),
+        percentile(h, 90), percentile(h, 99), percentile(h, 99.9), h->max_ns);
+  }
+
+  g_string_append(out, "\n# class bucket-floor-ns count\n");
+  for (guint c = 0; c < DKST_LATENCY_N_CLASSES; c++) {
+    for (guint i = 0; i < N_BUCKETS; i++) {
+      if (histograms[c].buckets[i]) {
+        g_string_append_printf(out,
+                               "%s %" G_GUINT64_FORMAT " %" G_GUINT64_FORMAT
+                               "\n",
+                               class_names[c], bucket_floor(i),
+                               histograms[c].buckets[i]);
+      }
+    }
+  }
+
+  gboolean ok = g_file_set_contents(path, out->str, out->len, error);
+  g_string_free(out, TRUE);
+  return ok;
+}
+
+void dkst_latency_reset(void) { memset(histograms, 0, sizeof(histograms)); }
+
+#else
+
+gboolean dkst_latency_dump(const char *path, GError **error) {
+  return g_file_set_contents(
+      path, "# Latency histograms were compiled out (DKST_NO_LATENCY)\n", -1,
+      error);
+}
+
+void dkst_latency_reset(void) {}
+
+#endif
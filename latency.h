@@ -0,0 +1,51 @@
+#ifndef DKST_LATENCY_H
+#define DKST_LATENCY_H
+
+#include <glib.h>
+#include <time.h>
+
+// Key event latency histograms. The engine times every key press and files
+// the time under what the key did, in fixed log-linear buckets (four per
+// power of two, so a value is off by at most 25%). Recording is a clock
+// read and a few increments: no locks, no allocation. Only the main loop
+// records and dumps. Build with -DDKST_NO_LATENCY to compile it out.
+
+typedef enum {
+  DKST_LATENCY_COMPOSE,          // Changed the syllable being composed
+  DKST_LATENCY_COMMIT,           // Committed text
+  DKST_LATENCY_HANJA_OPEN,       // Looked up and showed Hanja candidates
+  DKST_LATENCY_CANDIDATE_MOVE,   // Moved the cursor or page in candidates
+  DKST_LATENCY_CANDIDATE_SELECT, // Replaced text with a candidate
+  DKST_LATENCY_OTHER,            // Passed through, mode toggles, ...
+  DKST_LATENCY_N_CLASSES
+} DkstLatencyClass;
+
+#ifndef DKST_NO_LATENCY
+
+// Monotonic nanoseconds (g_get_monotonic_time() is too coarse for keys)
+static inline gint64 dkst_latency_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (gint64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void dkst_latency_record(DkstLatencyClass cls, gint64 ns);
+
+#else
+
+static inline gint64 dkst_latency_now(void) { return 0; }
+
+static inline void dkst_latency_record(DkstLatencyClass cls, gint64 ns) {
+  (void)cls;
+  (void)ns;
+}
+
+#endif
+
+// Write a text report of every class (count, mean, percentiles and the
+// non-empty buckets) to path
+gboolean dkst_latency_dump(const char *path, GError **error);
+
+void dkst_latency_reset(void);
+
+#endif
@@ -11,6 +11,14 @@ from gi.repository import Gtk, Gdk, GdkPixbuf
 CONFIG_DIR = os.path.expanduser("~/.config/ibus-dkst")
 CONFIG_FILE = os.path.join(CONFIG_DIR, "config.ini")
 
+# Keyboard layouts compiled into the engine (layouts/*.layout)
+# Format: (Config Value, Display Name)
+LAYOUTS = [
+    ("dubeolsik", "Dubeolsik (두벌식 표준)"),
+    ("sebeolsik-390", "Sebeolsik 390 (세벌식 390)"),
+    ("sebeolsik-final", "Sebeolsik Final (세벌식 최종)"),
+]
+
 # Key list from macOS PreferencesController.m
 # Format: (Display Name, Config Key)
 # We assume the user wants to map "Shift + Key".
@@ -101,6 +109,10 @@ class SettingsWindow(Gtk.Window):
         # Indicator
         self.check_indicator = Gtk.CheckButton(label="Show Cursor Language Indicator (한/A)")
         vbox_gen.pack_start(self.check_indicator, False, False, 0)
+
+        # Word preedit
+        self.check_word = Gtk.CheckButton(label="Compose Whole Words Before Committing")
+        vbox_gen.pack_start(self.check_word, False, False, 0)
         
         # Backspace Mode
         hbox_bs = Gtk.Box(orientation=Gtk.Orientation.HORIZONTAL, spacing=10)
@@ -112,6 +124,16 @@ class SettingsWindow(Gtk.Window):
         hbox_bs.pack_start(self.bs_char, False, False, 0)
         hbox_bs.pack_start(self.bs_jaso, False, False, 0)
 
+        # Keyboard Layout
+        hbox_layout = Gtk.Box(orientation=Gtk.Orientation.HORIZONTAL, spacing=10)
+        vbox_gen.pack_start(hbox_layout, False, False, 0)
+        hbox_layout.pack_start(Gtk.Label(label="Keyboard Layout:"), False, False, 0)
+
+        self.combo_layout = Gtk.ComboBoxText()
+        for layout_id, label in LAYOUTS:
+            self.combo_layout.append(layout_id, label)
+        hbox_layout.pack_start(self.combo_layout, False, False, 0)
+
         # 2. Toggle Keys Frame
         frame_toggle = Gtk.Frame(label="Hangul Toggle Keys (한영전환)")
         main_vbox.pack_start(frame_toggle, False, False, 0)
@@ -248,7 +270,9 @@ class SettingsWindow(Gtk.Window):
         is_moa = False
         is_indicator = True
         bs_mode = "JASO"
+        layout = "dubeolsik"
         is_custom = False
+        is_word = False
         toggle_keys_str = "Shift+space;Hangul"
         hanja_keys_str = "Alt+Return;Hangul_Hanja"
 
@@ -259,7 +283,9 @@ class SettingsWindow(Gtk.Window):
                     is_moa = self.config.getboolean("Settings", "EnableMoaJjiki", fallback=False)
                     is_indicator = self.config.getboolean("Settings", "EnableIndicator", fallback=True)
                     bs_mode = self.config.get("Settings", "BackspaceMode", fallback="JASO")
+                    layout = self.config.get("Settings", "Layout", fallback="dubeolsik")
                     is_custom = self.config.getboolean("Settings", "EnableCustomShift", fallback=False)
+                    is_word = self.config.getboolean("Settings", "WordPreedit", fallback=False)
                 
                 if "ToggleKeys" in self.config and "Keys" in self.config["ToggleKeys"]:
                     toggle_keys_str = self.config["ToggleKeys"]["Keys"]
@@ -279,10 +305,13 @@ class SettingsWindow(Gtk.Window):
         # Set UI state
         self.check_moa.set_active(is_moa)
         self.check_indicator.set_active(is_indicator)
+        self.check_word.set_active(is_word)
         if bs_mode == "CHAR":
             self.bs_char.set_active(True)
         else:
             self.bs_jaso.set_active(True)
+        if not self.combo_layout.set_active_id(layout):
+            self.combo_layout.set_active_id("dubeolsik")
         self.check_custom.set_active(is_custom)
         self.tree.set_sensitive(is_custom)
         
@@ -308,7 +337,9 @@ class SettingsWindow(Gtk.Window):
         self.config["Settings"]["EnableMoaJjiki"] = "true" if self.check_moa.get_active() else "false"
         self.config["Settings"]["EnableIndicator"] = "true" if self.check_indicator.get_active() else "false"
         self.config["Settings"]["BackspaceMode"] = "CHAR" if self.bs_char.get_active() else "JASO"
+        self.config["Settings"]["Layout"] = self.combo_layout.get_active_id() or "dubeolsik"
         self.config["Settings"]["EnableCustomShift"] = "true" if self.check_custom.get_active() else "false"
+        self.config["Settings"]["WordPreedit"] = "true" if self.check_word.get_active() else "false"
         
         # Save Toggle Keys
         if "ToggleKeys" not in self.config:
@@ -341,8 +372,19 @@ class SettingsWindow(Gtk.Window):
         
         if not os.path.exists(CONFIG_DIR):
             os.makedirs(CONFIG_DIR)
-        with open(CONFIG_FILE, "w") as f:
-            self.config.write(f)
+        # dkst-ime reloads config.ini as soon as it changes; replacing it in
+        # one rename keeps it from reading half the settings
+        tmp_file = CONFIG_FILE + ".tmp"
+        try:
+            with open(tmp_file, "w") as f:
+                self.config.write(f)
+            os.replace(tmp_file, CONFIG_FILE)
+        except OSError:
+            try:
+                os.remove(tmp_file)
+            except OSError:
+                pass
+            raise
 
     def on_add_key(self, widget):
         dlg = KeyCaptureDialog(self)
@@ -0,0 +1,95 @@
+#include "stats.h"
+#include <stdio.h>
+
+DkstStats dkst_stats;
+
+static const char introspection_xml[] =
+    "<node>"
+    "  <interface name='" DKST_STATS_INTERFACE "'>"
+    "    <method name='GetStats'>"
+    "      <arg type='a{st}' name='stats' direction='out'/>"
+    "    </method>"
+    "  </interface>"
+    "</node>";
+
+static GVariant *stats_to_variant(void) {
+  GVariantBuilder builder;
+  g_variant_builder_init(&builder, G_VARIANT_TYPE("a{st}"));
+  g_variant_builder_add(&builder, "{st}", "keys", dkst_stats.keys);
+  g_variant_builder_add(&builder, "{st}", "hanja-hits", dkst_stats.hanja_hits);
+  g_variant_builder_add(&builder, "{st}", "hanja-misses",
+                        dkst_stats.hanja_misses);
+  g_variant_builder_add(&builder, "{st}", "hanja-not-ready",
+                        dkst_stats.hanja_not_ready);
+  g_variant_builder_add(&builder, "{st}", "config-loads",
+                        dkst_stats.config_loads);
+  g_variant_builder_add(&builder, "{st}", "user-dict-reloads",
+                        dkst_stats.user_dict_reloads);
+  g_variant_builder_add(&builder, "{st}", "commits", dkst_stats.commits);
+  g_variant_builder_add(&builder, "{st}", "preedit-updates",
+                        dkst_stats.preedit_updates);
+  g_variant_builder_add(&builder, "{st}", "preedit-updates-skipped",
+                        dkst_stats.preedit_updates_skipped);
+  g_variant_builder_add(&builder, "{st}", "property-updates",
+                        dkst_stats.property_updates);
+  g_variant_builder_add(&builder, "{st}", "property-updates-skipped",
+                        dkst_stats.property_updates_skipped);
+  g_variant_builder_add(&builder, "{st}", "engines-created",
+                        dkst_stats.engines_created);
+  g_variant_builder_add(&builder, "{st}", "engines-live",
+                        (guint64)dkst_stats.engines_live);
+  g_variant_builder_add(&builder, "{st}", "dict-keys",
+                        (guint64)dkst_stats.dict.n_keys);
+  g_variant_builder_add(&builder, "{st}", "dict-candidates",
+                        (guint64)dkst_stats.dict.n_candidates);
+  g_variant_builder_add(&builder, "{st}", "dict-mapped-bytes",
+                        (guint64)dkst_stats.dict.mapped_bytes);
+  g_variant_builder_add(&builder, "{st}", "dict-heap-bytes",
+                        (guint64)dkst_stats.dict.heap_bytes);
+  return g_variant_new("(a{st})", &builder);
+}
+
+static void on_method_call(GDBusConnection *connection, const gchar *sender,
+                           const gchar *object_path,
+                           const gchar *interface_name,
+                           const gchar *method_name, GVariant *parameters,
+                           GDBusMethodInvocation *invocation,
+                           gpointer user_data) {
+  // GetStats is the only method in the introspection data, and GDBus
+  // rejects calls to anything else
+  g_dbus_method_invocation_return_value(invocation, stats_to_variant());
+}
+
+static const GDBusInterfaceVTable vtable = {on_method_call, NULL, NULL};
+
+gboolean dkst_stats_export(GDBusConnection *connection, GError **error) {
+  GDBusNodeInfo *info = g_dbus_node_info_new_for_xml(introspection_xml, error);
+  if (!info)
+    return FALSE;
+
+  guint id = g_dbus_connection_register_object(connection, DKST_STATS_PATH,
+                                               info->interfaces[0], &vtable,
+                                               NULL, NULL, error);
+  g_dbus_node_info_unref(info);
+  return id != 0;
+}
+
+gboolean dkst_stats_print(GDBusConnection *connection, const char *bus_name,
+                          GError **error) {
+  GVariant *reply = g_dbus_connection_call_sync(
+      connection, bus_name, DKST_STATS_PATH, DKST_STATS_INTERFACE, "GetStats",
+      NULL, G_VARIANT_TYPE("(a{st})"), G_DBUS_CALL_FLAGS_NONE, -1, NULL,
+      error);
+  if (!reply)
+    return FALSE;
+
+  GVariantIter *iter;
+  const gchar *name;
+  guint64 value;
+  g_variant_get(reply, "(a{st})", &iter);
+  while (g_variant_iter_next(iter, "{&st}", &name, &value))
+    printf("%-24s %" G_GUINT64_FORMAT "\n", name, value);
+  g_variant_iter_free(iter);
+  g_variant_unref(reply);
+  return TRUE;
+}
@@ -0,0 +1,39 @@
+#ifndef DKST_STATS_H
+#define DKST_STATS_H
+
+#include "hanja_dict.h"
+#include <gio/gio.h>
+
+// Runtime counters of dkst-ime, read over D-Bus with dkst-ime --stats.
+// Everything here is written and read on the main loop, so counting is a
+// plain increment.
+typedef struct {
+  guint64 keys;                     // Key presses processed
+  guint64 hanja_hits;               // Hanja lookups that found candidates
+  guint64 hanja_misses;             // Hanja lookups that found none
+  guint64 hanja_not_ready;          // Hanja requests during the dictionary load
+  guint64 config_loads;             // config.ini reads
+  guint64 user_dict_reloads;        // User dictionary snapshots published
+  guint64 commits;                  // Text committed to clients
+  guint64 preedit_updates;          // Preedit updates and hides sent
+  guint64 preedit_updates_skipped;  // Ones the client already showed
+  guint64 property_updates;         // Property updates and registrations
+  guint64 property_updates_skipped; // Ones the panel already showed
+  guint64 engines_created;
+  guint engines_live;
+  HanjaDictInfo dict;               // Snapshot engines currently look up in
+} DkstStats;
+
+extern DkstStats dkst_stats;
+
+#define DKST_STATS_PATH "/com/dkst/inputmethod/Stats"
+#define DKST_STATS_INTERFACE "com.dkst.inputmethod.Stats"
+
+// Serve GetStats() -> a{st} (counter name to value) at DKST_STATS_PATH
+gboolean dkst_stats_export(GDBusConnection *connection, GError **error);
+
+// Call GetStats() on bus_name and print one "name value" line per counter
+gboolean dkst_stats_print(GDBusConnection *connection, const char *bus_name,
+                          GError **error);
+
+#endif
@@ -0,0 +1,120 @@
+#include "hangul.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Proves the composition core never touches the heap: every allocator entry
+// point is wrapped with a counter, then keystrokes are fed through each
+// layout while counting. Built without GLib, which also proves hangul.c
+// doesn't need it.
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t n, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void __libc_free(void *ptr);
+
+static int counting = 0;
+static long n_heap_calls = 0;
+
+void *malloc(size_t size) {
+  n_heap_calls += counting;
+  return __libc_malloc(size);
+}
+
+void *calloc(size_t n, size_t size) {
+  n_heap_calls += counting;
+  return __libc_calloc(n, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+  n_heap_calls += counting;
+  return __libc_realloc(ptr, size);
+}
+
+void free(void *ptr) {
+  n_heap_calls += counting && ptr;
+  __libc_free(ptr);
+}
+
+// Mixed Hangul, symbols, digits and backspaces ('\b')
+static const char *inputs[] = {
+    "dkssudgktpdy rkskekfk!",
+    "dlTrh dlqslek. qkfqrh\b\bdmf",
+    "jfs kkf jfqq jfUIO jfsHJ \b\b",
+    "ABCdefGHI 0123456789 ~!@#$%^&*()",
+};
+
+// Bulk API output (dubeolsik). A '\b' the automaton does not use deletes
+// the character written before it instead of coming out as a raw byte.
+static const struct {
+  const char *keys;
+  const char *out;
+} bulk[] = {
+    {"gks \b\bdk ", "아 "},
+    {"\b\b1 2\b", "1 "},
+    {"rk 123\b\b\bdk ", "가 아 "},
+    {"gks\b\b\b\b", ""},
+    {"rk\n\bdk ", "가\n아 "},
+};
+
+int main() {
+  const char *layouts[] = {"dubeolsik", "sebeolsik-390", "sebeolsik-final"};
+  uint32_t commit_buf[DKST_HANGUL_MAX_COMMIT];
+  char text[DKST_HANGUL_MAX_COMMIT * 4 + 1];
+  long n_keys = 0;
+  DKSTHangul h;
+
+  for (size_t l = 0; l < sizeof(layouts) / sizeof(layouts[0]); l++) {
+    dkst_hangul_init(&h, commit_buf, DKST_HANGUL_MAX_COMMIT);
+    if (!dkst_hangul_set_layout(&h, layouts[l])) {
+      printf("FAIL: unknown layout %s\n", layouts[l]);
+      return 1;
+    }
+
+    counting = 1;
+    for (int round = 0; round < 1000; round++) {
+      for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); i++) {
+        for (const char *k = inputs[i]; *k; k++, n_keys++) {
+          if (*k == '\b')
+            dkst_hangul_backspace(&h);
+          else
+            dkst_hangul_process(&h, *k);
+          dkst_hangul_current_syllable(&h);
+          dkst_hangul_take_commit(&h, text, sizeof(text));
+        }
+        dkst_hangul_reset(&h);
+      }
+
+      // Same keys through the bulk API
+      for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); i++) {
+        char out[256];
+        size_t len = strlen(inputs[i]);
+        dkst_hangul_process_string(&h, inputs[i], len, out, sizeof(out), NULL);
+        dkst_hangul_reset(&h);
+        n_keys += len;
+      }
+    }
+    counting = 0;
+  }
+
+  dkst_hangul_init(&h, commit_buf, DKST_HANGUL_MAX_COMMIT);
+  for (size_t i = 0; i < sizeof(bulk) / sizeof(bulk[0]); i++) {
+    char out[256];
+    dkst_hangul_process_string(&h, bulk[i].keys, strlen(bulk[i].keys), out,
+                               sizeof(out), NULL);
+    dkst_hangul_reset(&h);
+    if (strcmp(out, bulk[i].out) != 0) {
+      printf("FAIL: process_string gave '%s', expected '%s'\n", out,
+             bulk[i].out);
+      return 1;
+    }
+  }
+
+  printf("%ld keystrokes, %ld heap calls\n", n_keys, n_heap_calls);
+  if (n_heap_calls != 0) {
+    printf("FAIL: composition core touched the heap\n");
+    return 1;
+  }
+  printf("PASS\n");
+  return 0;
+}
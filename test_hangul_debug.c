@@ -7,7 +7,8 @@
 // Mock main to test logic
 int main() {
   DKSTHangul h;
-  dkst_hangul_init(&h);
+  uint32_t commit_buf[DKST_HANGUL_MAX_COMMIT];
+  dkst_hangul_init(&h, commit_buf, DKST_HANGUL_MAX_COMMIT);
 
   printf("--- Test 1: 입니.다 ---\n");
   // "입니.다" input: d l q s l e k .
@@ -31,10 +32,9 @@ int main() {
       printf("Current=(none) ");
     }
 
-    char *committed = dkst_hangul_get_commit_string(&h);
-    if (committed) {
+    char committed[16];
+    if (dkst_hangul_take_commit(&h, committed, sizeof(committed))) {
       printf("COMMITTED='%s'", committed);
-      g_free(committed);
     }
     printf("\n");
     if (!consumed && key == '.') {
@@ -65,10 +65,9 @@ int main() {
       printf("Current='%s' ", buf);
     }
 
-    char *committed = dkst_hangul_get_commit_string(&h);
-    if (committed) {
+    char committed[16];
+    if (dkst_hangul_take_commit(&h, committed, sizeof(committed))) {
       printf(" COMMITTED='%s'", committed);
-      g_free(committed);
     }
     printf("\n");
   }
@@ -111,6 +110,5 @@ int main() {
   printf("After BS (CHAR): %x (Expected 0)\n",
          dkst_hangul_current_syllable(&h));
 
-  dkst_hangul_free(&h);
   return 0;
 }
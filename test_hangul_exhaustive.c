@@ -0,0 +1,338 @@
+#include "hangul.h"
+#include "hangul_ref.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Runs every sequence of Dubeolsik keys and backspaces up to a given length
+// through the composition core and through the frozen original automaton
+// (hangul_ref.c), with moa-jjiki on and off and both backspace modes. After
+// every key both must agree on the return value, the state, the committed
+// codepoints and the syllable shown, and the core must keep its invariants:
+// only syllables or compatibility jamo come out, the UTF-8 it commits
+// matches those codepoints, and every jamo typed is either committed, still
+// composing or erased by a backspace.
+//
+// Usage: test_hangul_exhaustive [-n length] [-j threads]
+
+#define MAX_LENGTH 16
+#define MAX_REPORTS 20
+
+// Every distinct Dubeolsik key, a key that is not Hangul and backspace
+static const char dubeolsik_keys[] = "qwertyuiopasdfghjklzxcvbnmQWERTOP1\b";
+
+typedef struct {
+  const char *keys;
+  int length;
+  bool moa_jjiki;
+  DKSTBackspaceMode backspace_mode;
+} Config;
+
+typedef struct {
+  DKSTHangul h;
+  RefHangul ref;
+  int pending; // Jamo typed and neither committed nor erased yet
+} Node;
+
+typedef struct {
+  const Config *config;
+  uint32_t commit_buf[DKST_HANGUL_MAX_COMMIT];
+  char seq[MAX_LENGTH];
+  unsigned long n_sequences;
+  unsigned long n_failures;
+} Walker;
+
+static Config *configs;
+static size_t n_configs;
+static size_t n_jobs; // Every config times every first key
+static size_t next_job;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned long n_sequences, n_failures;
+
+static bool is_compound_jung(uint32_t c) {
+  return c == 0x116A || c == 0x116B || c == 0x116C || c == 0x116F ||
+         c == 0x1170 || c == 0x1171 || c == 0x1174;
+}
+
+static bool is_compound_jong(uint32_t c) {
+  return c == 0x11AA || c == 0x11AC || c == 0x11AD ||
+         (c >= 0x11B0 && c <= 0x11B6) || c == 0x11B9;
+}
+
+// Keys it takes to type a jamo (two for ㅘ or ㄺ)
+static int jung_keys(uint32_t c) { return c ? 1 + is_compound_jung(c) : 0; }
+static int jong_keys(uint32_t c) { return c ? 1 + is_compound_jong(c) : 0; }
+
+static int state_keys(const DKSTHangul *h) {
+  return (h->cho != 0) + jung_keys(h->jung) + jong_keys(h->jong);
+}
+
+// Keys behind a committed codepoint, or -1 if it should never be committed
+static int committed_keys(uint32_t c) {
+  if (c >= 0xAC00 && c <= 0xD7A3) {
+    uint32_t s = c - 0xAC00;
+    uint32_t jong = s % 28;
+    return 1 + jung_keys(0x1161 + s % 588 / 28) +
+           jong_keys(jong ? 0x11A7 + jong : 0);
+  }
+  switch (c) {
+  case 0x3133: // ㄳ
+  case 0x3135: // ㄵ
+  case 0x3136: // ㄶ
+  case 0x313A: // ㄺ ... ㅀ
+  case 0x313B:
+  case 0x313C:
+  case 0x313D:
+  case 0x313E:
+  case 0x313F:
+  case 0x3140:
+  case 0x3144: // ㅄ
+  case 0x3158: // ㅘ
+  case 0x3159: // ㅙ
+  case 0x315A: // ㅚ
+  case 0x315D: // ㅝ
+  case 0x315E: // ㅞ
+  case 0x315F: // ㅟ
+  case 0x3162: // ㅢ
+    return 2;
+  }
+  if (c >= 0x3131 && c <= 0x3163)
+    return 1;
+  return -1;
+}
+
+static bool valid_state(const DKSTHangul *h) {
+  if (h->cho && !(h->cho >= 0x1100 && h->cho <= 0x1112))
+    return false;
+  if (h->jung && !(h->jung >= 0x1161 && h->jung <= 0x1175))
+    return false;
+  if (h->jong && !(h->jong >= 0x11A8 && h->jong <= 0x11C2))
+    return false;
+  // A final consonant needs the rest of the syllable
+  return !h->jong || (h->cho && h->jung);
+}
+
+static size_t encode_utf8(const uint32_t *cps, size_t n, char *out) {
+  size_t len = 0;
+  for (size_t i = 0; i < n; i++) {
+    uint32_t c = cps[i];
+    if (c < 0x80) {
+      out[len++] = c;
+    } else if (c < 0x800) {
+      out[len++] = 0xC0 | (c >> 6);
+      out[len++] = 0x80 | (c & 0x3F);
+    } else {
+      out[len++] = 0xE0 | (c >> 12);
+      out[len++] = 0x80 | ((c >> 6) & 0x3F);
+      out[len++] = 0x80 | (c & 0x3F);
+    }
+  }
+  out[len] = '\0';
+  return len;
+}
+
+// Apply one key to both automata and check them. Returns NULL, or what went
+// wrong.
+static const char *step(Node *n, const Config *config, char key) {
+  bool ret, ref_ret;
+
+  if (key == '\b') {
+    int before = state_keys(&n->h);
+    ret = dkst_hangul_backspace(&n->h);
+    ref_ret = ref_hangul_backspace(&n->ref);
+    if (ret)
+      n->pending -= config->backspace_mode == DKST_BACKSPACE_CHAR ? before : 1;
+  } else {
+    ret = dkst_hangul_process(&n->h, key);
+    ref_ret = ref_hangul_process(&n->ref, key);
+    if (ret)
+      n->pending++;
+  }
+
+  if (ret != ref_ret)
+    return "return value differs from the reference";
+  if (n->h.cho != n->ref.cho || n->h.jung != n->ref.jung ||
+      n->h.jong != n->ref.jong)
+    return "state differs from the reference";
+  if (!valid_state(&n->h))
+    return "invalid composition state";
+
+  if (n->h.commit_len != n->ref.completed_len ||
+      memcmp(n->h.commit, n->ref.completed,
+             n->h.commit_len * sizeof(uint32_t)) != 0)
+    return "committed text differs from the reference";
+  for (size_t i = 0; i < n->h.commit_len; i++) {
+    int keys = committed_keys(n->h.commit[i]);
+    if (keys < 0)
+      return "committed a codepoint that is not a syllable or jamo";
+    n->pending -= keys;
+  }
+
+  char expected[DKST_HANGUL_MAX_COMMIT * 4 + 1];
+  char text[DKST_HANGUL_MAX_COMMIT * 4 + 1];
+  size_t expected_len = encode_utf8(n->h.commit, n->h.commit_len, expected);
+  size_t len = dkst_hangul_take_commit(&n->h, text, sizeof(text));
+  if (len != expected_len || strcmp(text, expected) != 0 ||
+      n->h.commit_len != 0)
+    return "committed UTF-8 does not match the committed codepoints";
+  n->ref.completed_len = 0;
+
+  uint32_t syl = dkst_hangul_current_syllable(&n->h);
+  if (syl != ref_hangul_current_syllable(&n->ref))
+    return "composing syllable differs from the reference";
+  if (dkst_hangul_has_composed(&n->h) != (syl != 0))
+    return "has_composed disagrees with the composing syllable";
+  if (syl && committed_keys(syl) != state_keys(&n->h))
+    return "composing syllable does not show the state";
+
+  if (n->pending != state_keys(&n->h))
+    return "jamo lost or duplicated";
+  return NULL;
+}
+
+static void report(Walker *w, int len, const char *error) {
+  pthread_mutex_lock(&lock);
+  if (n_failures + w->n_failures < MAX_REPORTS) {
+    printf("FAIL (moa-jjiki %s, backspace %s): ",
+           w->config->moa_jjiki ? "on" : "off",
+           w->config->backspace_mode == DKST_BACKSPACE_JASO ? "jaso" : "char");
+    for (int i = 0; i < len; i++) {
+      if (w->seq[i] == '\b')
+        printf("<BS>");
+      else
+        putchar(w->seq[i]);
+    }
+    printf(": %s\n", error);
+  }
+  pthread_mutex_unlock(&lock);
+  w->n_failures++;
+}
+
+// Check every continuation of the len keys that led to node
+static void walk(Walker *w, const Node *node, int len) {
+  w->n_sequences++;
+  if (len == w->config->length)
+    return;
+
+  for (const char *k = w->config->keys; *k; k++) {
+    Node next = *node;
+    w->seq[len] = *k;
+    const char *error = step(&next, w->config, *k);
+    if (error)
+      report(w, len + 1, error); // Its continuations would fail too
+    else
+      walk(w, &next, len + 1);
+  }
+}
+
+static void *worker(void *data) {
+  Walker w = {0};
+  (void)data;
+
+  for (;;) {
+    pthread_mutex_lock(&lock);
+    size_t job = next_job++;
+    pthread_mutex_unlock(&lock);
+    if (job >= n_jobs)
+      break;
+
+    // Jobs are numbered config by config, then by first key
+    size_t c = 0;
+    while (job >= strlen(configs[c].keys))
+      job -= strlen(configs[c++].keys);
+    w.config = &configs[c];
+
+    Node root;
+    dkst_hangul_init(&root.h, w.commit_buf, DKST_HANGUL_MAX_COMMIT);
+    ref_hangul_init(&root.ref);
+    root.h.moa_jjiki_enabled = root.ref.moa_jjiki_enabled = w.config->moa_jjiki;
+    root.h.backspace_mode = w.config->backspace_mode;
+    root.ref.backspace_mode = w.config->backspace_mode == DKST_BACKSPACE_JASO
+                                  ? REF_BACKSPACE_JASO
+                                  : REF_BACKSPACE_CHAR;
+    root.pending = 0;
+
+    w.seq[0] = w.config->keys[job];
+    const char *error = step(&root, w.config, w.seq[0]);
+    if (error)
+      report(&w, 1, error);
+    else
+      walk(&w, &root, 1);
+  }
+
+  pthread_mutex_lock(&lock);
+  n_sequences += w.n_sequences;
+  n_failures += w.n_failures;
+  pthread_mutex_unlock(&lock);
+  return NULL;
+}
+
+static void add_configs(const char *keys, int length) {
+  for (int moa = 0; moa < 2; moa++) {
+    for (int bs = 0; bs < 2; bs++) {
+      Config *c = &configs[n_configs++];
+      c->keys = keys;
+      c->length = length;
+      c->moa_jjiki = moa;
+      c->backspace_mode = bs ? DKST_BACKSPACE_CHAR : DKST_BACKSPACE_JASO;
+      n_jobs += strlen(keys);
+    }
+  }
+}
+
+int main(int argc, char **argv) {
+  int length = 5;
+  long n_threads = sysconf(_SC_NPROCESSORS_ONLN);
+  int opt;
+
+  while ((opt = getopt(argc, argv, "n:j:")) != -1) {
+    switch (opt) {
+    case 'n':
+      length = atoi(optarg);
+      break;
+    case 'j':
+      n_threads = strtol(optarg, NULL, 10);
+      break;
+    default:
+      fprintf(stderr, "Usage: %s [-n length] [-j threads]\n", argv[0]);
+      return 1;
+    }
+  }
+  if (length < 1 || length > MAX_LENGTH) {
+    fprintf(stderr, "%s: length must be 1 to %d\n", argv[0], MAX_LENGTH);
+    return 1;
+  }
+  if (n_threads < 1)
+    n_threads = 1;
+
+  // Every ASCII key (symbols, digits, Shift variants that type the same
+  // jamo) for short sequences, then the Dubeolsik keys up to length
+  char all_keys[128];
+  int n = 0;
+  for (int c = 1; c < 128; c++)
+    all_keys[n++] = c;
+  all_keys[n] = '\0';
+
+  configs = calloc(8, sizeof(Config));
+  add_configs(all_keys, length < 3 ? length : 3);
+  add_configs(dubeolsik_keys, length);
+
+  pthread_t *threads = calloc(n_threads, sizeof(pthread_t));
+  for (long i = 0; i < n_threads; i++)
+    pthread_create(&threads[i], NULL, worker, NULL);
+  for (long i = 0; i < n_threads; i++)
+    pthread_join(threads[i], NULL);
+  free(threads);
+  free(configs);
+
+  printf("%lu key sequences up to length %d, %lu failures\n", n_sequences,
+         length, n_failures);
+  if (n_failures != 0) {
+    printf("FAIL\n");
+    return 1;
+  }
+  printf("PASS\n");
+  return 0;
+}
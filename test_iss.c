@@ -16,8 +16,8 @@ int main() {
   printf("--- Debugging 'Iss' (있) ---\n");
 
   // 1. Verify Map Key
-  uint32_t t_map = map_key('T');
-  printf("map_key('T') = 0x%X (Expected 0x110A)\n", t_map);
+  uint32_t t_map = map_key(&dkst_layouts[0], 'T');
+  printf("map_key(dubeolsik, 'T') = 0x%X (Expected 0x110A)\n", t_map);
 
   // 2. Verify Cho to Jong
   uint32_t jong_mapped = cho_to_jong(t_map);
@@ -25,7 +25,8 @@ int main() {
 
   // 3. Trace Process
   DKSTHangul h;
-  dkst_hangul_init(&h);
+  uint32_t commit_buf[DKST_HANGUL_MAX_COMMIT];
+  dkst_hangul_init(&h, commit_buf, DKST_HANGUL_MAX_COMMIT);
 
   // 'd'
   dkst_hangul_process(&h, 'd');
@@ -38,7 +39,7 @@ int main() {
   // 'T'
   printf("Processing 'T'...\n");
   // Manual step simulation
-  uint32_t hangul = map_key('T'); // 0x110A
+  uint32_t hangul = map_key(&dkst_layouts[0], 'T'); // 0x110A
   if (IS_CHO(hangul)) {
     printf("  IS_CHO is true.\n");
     printf("  h->jung is %X (should be non-zero)\n", h.jung);
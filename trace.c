@@ -0,0 +1,97 @@
+#include "trace.h"
+#include <time.h>
+
+#ifndef DKST_NO_TRACE
+
+typedef struct {
+  gint64 ns;
+  guint32 event;
+  guint32 args[3];
+} TraceEntry;
+
+typedef struct {
+  const char *name;
+  guint n_args;
+  guint hex_args; // Bit i set: argument i is printed in hex
+} TraceEventInfo;
+
+static const TraceEventInfo event_info[DKST_TRACE_N_EVENTS] = {
+    [DKST_TRACE_KEY] = {"key", 3, 0x3},
+    [DKST_TRACE_MODE_TOGGLE] = {"mode-toggle", 1},
+    [DKST_TRACE_COMMIT] = {"commit", 1},
+    [DKST_TRACE_FOCUS_IN] = {"focus-in", 1, 0x1},
+    [DKST_TRACE_FOCUS_OUT] = {"focus-out", 1, 0x1},
+    [DKST_TRACE_RESET] = {"reset", 1, 0x1},
+    [DKST_TRACE_DISABLE] = {"disable", 0},
+    [DKST_TRACE_CAPABILITIES] = {"capabilities", 1, 0x1},
+    [DKST_TRACE_HANJA_LOOKUP] = {"hanja-lookup", 3},
+    [DKST_TRACE_HANJA_NOT_READY] = {"hanja-not-ready", 1},
+    [DKST_TRACE_HANJA_TABLE_LOST] = {"hanja-table-lost", 1, 0x1},
+    [DKST_TRACE_CONFIG_LOADED] = {"config-loaded", 3},
+    [DKST_TRACE_CONFIG_KEY] = {"config-key", 3, 0x6},
+    [DKST_TRACE_CONFIG_BAD_LAYOUT] = {"config-bad-layout", 0},
+    [DKST_TRACE_WATCH_FAILED] = {"watch-failed", 1},
+    [DKST_TRACE_SPAWN_FAILED] = {"spawn-failed", 2},
+    [DKST_TRACE_DICT_LOADED] = {"dict-loaded", 1},
+    [DKST_TRACE_USER_DICT_REBUILT] = {"user-dict-rebuilt", 1},
+    [DKST_TRACE_DICT_TABLE_BUILT] = {"dict-table-built", 3},
+    [DKST_TRACE_DICT_OPEN_FAILED] = {"dict-open-failed", 0},
+    [DKST_TRACE_DICT_ARENA_LOADED] = {"dict-arena-loaded", 1},
+    [DKST_TRACE_DICT_IMAGE_MAPPED] = {"dict-image-mapped", 0},
+    [DKST_TRACE_DICT_IMAGE_WRITTEN] = {"dict-image-written", 2},
+};
+
+static TraceEntry ring[DKST_TRACE_SIZE];
+static guint head; // Entries ever recorded; wraps harmlessly
+
+void dkst_trace(DkstTraceEvent event, guint32 a, guint32 b, guint32 c) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  // Claiming a slot is the only shared step. A dump racing a writer may
+  // show that one entry half written, which is fine for a trace.
+  guint i = (guint)g_atomic_int_add((gint *)&head, 1) & (DKST_TRACE_SIZE - 1);
+  TraceEntry *entry = &ring[i];
+  entry->ns = (gint64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+  entry->event = event;
+  entry->args[0] = a;
+  entry->args[1] = b;
+  entry->args[2] = c;
+}
+
+gboolean dkst_trace_dump(const char *path, GError **error) {
+  guint end = (guint)g_atomic_int_get((gint *)&head);
+  guint n = MIN(end, DKST_TRACE_SIZE);
+  GString *out = g_string_new("");
+
+  g_string_append_printf(out,
+                         "# dkst-ime trace: last %u of %u events, "
+                         "seconds before the newest, event, arguments\n",
+                         n, end);
+  gint64 newest = n ? ring[(end - 1) & (DKST_TRACE_SIZE - 1)].ns : 0;
+  for (guint k = end - n; k != end; k++) {
+    const TraceEntry *entry = &ring[k & (DKST_TRACE_SIZE - 1)];
+    if (entry->event >= DKST_TRACE_N_EVENTS)
+      continue;
+    const TraceEventInfo *info = &event_info[entry->event];
+    g_string_append_printf(out, "%12.6f %s", (newest - entry->ns) / 1e9,
+                           info->name);
+    for (guint a = 0; a < info->n_args; a++)
+      g_string_append_printf(out, info->hex_args & (1u << a) ? " 0x%x" : " %u",
+                             entry->args[a]);
+    g_string_append_c(out, '\n');
+  }
+
+  gboolean ok = g_file_set_contents(path, out->str, out->len, error);
+  g_string_free(out, TRUE);
+  return ok;
+}
+
+#else
+
+gboolean dkst_trace_dump(const char *path, GError **error) {
+  return g_file_set_contents(
+      path, "# The trace ring was compiled out (DKST_NO_TRACE)\n", -1, error);
+}
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef DKST_TRACE_H
+#define DKST_TRACE_H
+
+#include <glib.h>
+
+// Trace ring: the last DKST_TRACE_SIZE events the engine and the dictionary
+// recorded, each an event id, up to three integer arguments and a monotonic
+// timestamp. Recording stores a fixed-size entry and never formats or
+// allocates, so it stays on in release builds; formatting happens only when
+// the ring is dumped (kill -USR2 dkst-ime). Any thread may record. Build with
+// -DDKST_NO_TRACE to compile it out.
+
+#define DKST_TRACE_SIZE 4096 // Entries kept, a power of two
+
+// Events and their arguments. Keep in step with the table in trace.c.
+typedef enum {
+  DKST_TRACE_KEY,                // keyval, state, Hangul mode | Hanja mode << 1
+  DKST_TRACE_MODE_TOGGLE,        // Hangul mode after the toggle
+  DKST_TRACE_COMMIT,             // Bytes committed
+  DKST_TRACE_FOCUS_IN,           // Leftover syllable dropped (0 if none)
+  DKST_TRACE_FOCUS_OUT,          // Syllable left to the client (0 if none)
+  DKST_TRACE_RESET,              // Syllable dropped (0 if none)
+  DKST_TRACE_DISABLE,            //
+  DKST_TRACE_CAPABILITIES,       // IBusCapabilite bits
+  DKST_TRACE_HANJA_LOOKUP,       // Bytes looked up, matches, candidates
+  DKST_TRACE_HANJA_NOT_READY,    // Bytes looked up
+  DKST_TRACE_HANJA_TABLE_LOST,   // keyval
+  DKST_TRACE_CONFIG_LOADED,      // Moa-jjiki, backspace mode, custom Shift
+  DKST_TRACE_CONFIG_KEY,         // 0 toggle / 1 Hanja, keyval, modifiers
+  DKST_TRACE_CONFIG_BAD_LAYOUT,  //
+  DKST_TRACE_WATCH_FAILED,       // GError code
+  DKST_TRACE_SPAWN_FAILED,       // 0 setup / 1 Hanja editor, GError code
+  DKST_TRACE_DICT_LOADED,        // Microseconds
+  DKST_TRACE_USER_DICT_REBUILT,  // Microseconds
+  DKST_TRACE_DICT_TABLE_BUILT,   // Keys, candidates, bytes
+  DKST_TRACE_DICT_OPEN_FAILED,   //
+  DKST_TRACE_DICT_ARENA_LOADED,  // Bytes
+  DKST_TRACE_DICT_IMAGE_MAPPED,  //
+  DKST_TRACE_DICT_IMAGE_WRITTEN, // Bytes, written
+  DKST_TRACE_N_EVENTS
+} DkstTraceEvent;
+
+#ifndef DKST_NO_TRACE
+
+void dkst_trace(DkstTraceEvent event, guint32 a, guint32 b, guint32 c);
+
+#else
+
+static inline void dkst_trace(DkstTraceEvent event, guint32 a, guint32 b,
+                              guint32 c) {
+  (void)event;
+  (void)a;
+  (void)b;
+  (void)c;
+}
+
+#endif
+
+// Write the ring, oldest entry first, as text to path
+gboolean dkst_trace_dump(const char *path, GError **error);
+
+#endif